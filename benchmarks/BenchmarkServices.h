@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QJsonObject>
+#include <QString>
+#include <QVariant>
+
+/**
+ * @brief Sample service covering the argument kinds handled by QJsonChannelService:
+ * numbers, strings, QVariant, JSON objects, overloads, properties and out-parameters.
+ * The methods don't share mutable state, so the service may be registered as thread-safe.
+ *
+ */
+class BenchmarkService : public QObject {
+    Q_OBJECT
+    Q_PROPERTY (int counter READ counter WRITE setCounter)
+    Q_PROPERTY (QString name MEMBER _name)
+
+public:
+    int counter () const {
+        return _counter.loadAcquire ();
+    }
+    void setCounter (int counter) {
+        _counter.storeRelease (counter);
+    }
+
+public Q_SLOTS:
+    int addInt (int first, int second) {
+        return first + second;
+    }
+
+    QString concat (const QString& first, const QString& second) {
+        return first + second;
+    }
+
+    QVariant echoVariant (const QVariant& value) {
+        return value;
+    }
+
+    QJsonObject echoObject (const QJsonObject& value) {
+        return value;
+    }
+
+    double scale (double value) {
+        return value * 2;
+    }
+
+    QString scale (const QString& value) {
+        return value + value;
+    }
+
+    int divide (int dividend, int divisor, int& remainder) {
+        remainder = dividend % divisor;
+        return dividend / divisor;
+    }
+
+private:
+    QAtomicInt _counter;
+    QString    _name = "benchmark";
+};
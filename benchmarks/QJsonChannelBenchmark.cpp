@@ -0,0 +1,287 @@
+#include <cstdlib>
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <functional>
+
+#include "QJsonChannelMessage.h"
+#include "QJsonChannelService.h"
+#include "QJsonChannelServiceRepository.h"
+
+#include "BenchmarkServices.h"
+
+// Allocations are counted by interposing the C allocator, every new/delete and Qt container ends up there
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc (size_t size);
+extern "C" void* __libc_calloc (size_t count, size_t size);
+extern "C" void* __libc_realloc (void* ptr, size_t size);
+
+static thread_local quint64 allocationCount = 0;
+
+extern "C" void* malloc (size_t size) {
+    ++allocationCount;
+    return __libc_malloc (size);
+}
+
+extern "C" void* calloc (size_t count, size_t size) {
+    ++allocationCount;
+    return __libc_calloc (count, size);
+}
+
+extern "C" void* realloc (void* ptr, size_t size) {
+    ++allocationCount;
+    return __libc_realloc (ptr, size);
+}
+
+#define QJSONCHANNEL_COUNT_ALLOCATIONS
+#endif
+
+namespace {
+
+const int allocationIterations = 1000;
+const int throughputCalls      = 200000;
+
+class CallRunnable : public QRunnable {
+public:
+    CallRunnable (const QJsonChannelServiceRepository& repository, const QJsonChannelMessage& request, int calls)
+        : _repository (repository), _request (request), _calls (calls) {
+    }
+
+    void run () override {
+        for (int i = 0; i < _calls; ++i)
+            _repository.processMessage (_request);
+    }
+
+private:
+    const QJsonChannelServiceRepository& _repository;
+    QJsonChannelMessage                  _request;
+    int                                  _calls;
+};
+
+} // namespace
+
+/**
+ * @brief Benchmarks of the message hot path: parse (fromJson), processMessage, dispatch and serialize (toJson/writeJson).
+ *
+ */
+class QJsonChannelBenchmark : public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase ();
+
+    void parse_data ();
+    void parse ();
+
+    void processMessage_data ();
+    void processMessage ();
+
+    void dispatch_data ();
+    void dispatch ();
+
+    void serialize_data ();
+    void serialize ();
+
+    void serializeCompact_data ();
+    void serializeCompact ();
+
+    void allocations_data ();
+    void allocations ();
+
+    void throughput_data ();
+    void throughput ();
+
+private:
+    void addRequests ();
+
+    QJsonChannelServiceRepository _repository;
+};
+
+void QJsonChannelBenchmark::initTestCase () {
+    QVERIFY (_repository.addThreadSafeService ("bench", "1.0", "thread-safe benchmark service", QSharedPointer<QObject> (new BenchmarkService)));
+    QVERIFY (_repository.addService ("guarded", "1.0", "mutex-guarded benchmark service", QSharedPointer<QObject> (new BenchmarkService)));
+
+    QSharedPointer<QJsonChannelService> serial (
+        new QJsonChannelService ("serial", "1.0", "executor-serialized benchmark service", QSharedPointer<QObject> (new BenchmarkService), false));
+    serial->setExecutor (QJsonChannelService::PoolExecutor);
+    QVERIFY (_repository.addService (serial));
+}
+
+void QJsonChannelBenchmark::addRequests () {
+    QTest::addColumn<QByteArray> ("request");
+
+    QTest::newRow ("int") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.addInt","params":[1,2]})");
+    QTest::newRow ("named int") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.addInt","params":{"first":1,"second":2}})");
+    QTest::newRow ("string") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.concat","params":["hello","world"]})");
+    QTest::newRow ("variant") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.echoVariant","params":[{"a":1,"b":"two"}]})");
+    QTest::newRow ("object") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.echoObject","params":[{"a":1,"b":[1,2,3],"c":{"d":true}}]})");
+    QTest::newRow ("overload") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.scale","params":["text"]})");
+    QTest::newRow ("getter") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.getCounter","params":[]})");
+    QTest::newRow ("setter") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.setCounter","params":[5]})");
+    QTest::newRow ("out parameter") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"bench.divide","params":[7,2]})");
+    QTest::newRow ("guarded int") << QByteArray (R"({"jsonrpc":"2.0","id":1,"method":"guarded.addInt","params":[1,2]})");
+}
+
+void QJsonChannelBenchmark::parse_data () {
+    addRequests ();
+}
+
+void QJsonChannelBenchmark::parse () {
+    QFETCH (QByteArray, request);
+
+    QBENCHMARK {
+        QJsonChannelMessage message = QJsonChannelMessage::fromJson (request);
+        Q_UNUSED (message);
+    }
+}
+
+void QJsonChannelBenchmark::processMessage_data () {
+    addRequests ();
+}
+
+void QJsonChannelBenchmark::processMessage () {
+    QFETCH (QByteArray, request);
+    const QJsonChannelMessage message = QJsonChannelMessage::fromJson (request);
+    QVERIFY (_repository.processMessage (message).type () == QJsonChannelMessage::Response);
+
+    QBENCHMARK {
+        _repository.processMessage (message);
+    }
+}
+
+void QJsonChannelBenchmark::dispatch_data () {
+    addRequests ();
+}
+
+void QJsonChannelBenchmark::dispatch () {
+    QFETCH (QByteArray, request);
+    const QJsonChannelMessage           message = QJsonChannelMessage::fromJson (request);
+    QSharedPointer<QJsonChannelService> service = _repository.getService (message.serviceName ().toLatin1 ());
+    QVERIFY (service);
+
+    QBENCHMARK {
+        service->dispatch (message);
+    }
+}
+
+void QJsonChannelBenchmark::serialize_data () {
+    addRequests ();
+}
+
+void QJsonChannelBenchmark::serialize () {
+    QFETCH (QByteArray, request);
+    const QJsonChannelMessage response = _repository.processMessage (QJsonChannelMessage::fromJson (request));
+
+    QBENCHMARK {
+        response.toJson ();
+    }
+}
+
+void QJsonChannelBenchmark::serializeCompact_data () {
+    addRequests ();
+}
+
+void QJsonChannelBenchmark::serializeCompact () {
+    QFETCH (QByteArray, request);
+    const QJsonChannelMessage response = _repository.processMessage (QJsonChannelMessage::fromJson (request));
+
+    QByteArray buffer;
+    buffer.reserve (4096);
+    QBENCHMARK {
+        buffer.truncate (0);
+        response.writeJson (buffer);
+    }
+}
+
+void QJsonChannelBenchmark::allocations_data () {
+    QTest::addColumn<QByteArray> ("request");
+    QTest::addColumn<int> ("stage");
+
+    const QByteArray requests[] = {R"({"jsonrpc":"2.0","id":1,"method":"bench.addInt","params":[1,2]})",
+                                   R"({"jsonrpc":"2.0","id":1,"method":"bench.concat","params":["hello","world"]})",
+                                   R"({"jsonrpc":"2.0","id":1,"method":"bench.echoObject","params":[{"a":1,"b":[1,2,3]}]})"};
+    const char*      names[]    = {"int", "string", "object"};
+    const char*      stages[]   = {"parse", "dispatch", "serialize"};
+
+    for (int stage = 0; stage < 3; ++stage) {
+        for (int i = 0; i < 3; ++i)
+            QTest::newRow ((QByteArray (stages[stage]) + ' ' + names[i]).constData ()) << requests[i] << stage;
+    }
+}
+
+void QJsonChannelBenchmark::allocations () {
+#if defined(QJSONCHANNEL_COUNT_ALLOCATIONS)
+    QFETCH (QByteArray, request);
+    QFETCH (int, stage);
+
+    const QJsonChannelMessage message  = QJsonChannelMessage::fromJson (request);
+    const QJsonChannelMessage response = _repository.processMessage (message);
+    QByteArray                buffer;
+    buffer.reserve (4096);
+
+    std::function<void ()> call;
+    switch (stage) {
+    case 0:
+        call = [&request] () { QJsonChannelMessage::fromJson (request).params (); };
+        break;
+    case 1:
+        call = [this, &message] () { _repository.processMessage (message); };
+        break;
+    default:
+        call = [&response, &buffer] () {
+            buffer.truncate (0);
+            response.writeJson (buffer);
+        };
+        break;
+    }
+
+    call (); // warm up caches and lazy statics
+    quint64 start = allocationCount;
+    for (int i = 0; i < allocationIterations; ++i)
+        call ();
+    quint64 allocations = allocationCount - start;
+
+    QTest::setBenchmarkResult (qreal (allocations) / allocationIterations, QTest::Events);
+#else
+    QSKIP ("allocation counting is supported only with glibc");
+#endif
+}
+
+void QJsonChannelBenchmark::throughput_data () {
+    QTest::addColumn<QByteArray> ("service");
+    QTest::addColumn<int> ("threads");
+
+    for (int threads = 1; threads <= qMax (1, QThread::idealThreadCount ()); threads *= 2) {
+        QTest::newRow (QByteArray ("thread-safe x" + QByteArray::number (threads)).constData ()) << QByteArray ("bench") << threads;
+        QTest::newRow (QByteArray ("mutex-guarded x" + QByteArray::number (threads)).constData ()) << QByteArray ("guarded") << threads;
+        QTest::newRow (QByteArray ("executor x" + QByteArray::number (threads)).constData ()) << QByteArray ("serial") << threads;
+    }
+}
+
+void QJsonChannelBenchmark::throughput () {
+    QFETCH (QByteArray, service);
+    QFETCH (int, threads);
+
+    const QJsonChannelMessage request = QJsonChannelMessage::createRequest (QString::fromLatin1 (service + ".addInt"), QJsonArray{1, 2});
+
+    QThreadPool pool;
+    pool.setMaxThreadCount (threads);
+
+    QElapsedTimer timer;
+    timer.start ();
+    for (int i = 0; i < threads; ++i)
+        pool.start (new CallRunnable (_repository, request, throughputCalls / threads));
+    pool.waitForDone ();
+    qint64 elapsed = qMax<qint64> (1, timer.elapsed ());
+
+    // the rate is printed with QJsonChannel_DEBUG set, the result is the wall time
+    QJsonChannelDebug () << service << threads << "threads:" << (throughputCalls / threads * threads) * 1000 / elapsed << "calls/s";
+    QTest::setBenchmarkResult (elapsed, QTest::WalltimeMilliseconds);
+}
+
+QTEST_GUILESS_MAIN (QJsonChannelBenchmark)
+
+#include "QJsonChannelBenchmark.moc"
@@ -0,0 +1,151 @@
+#include <QCborArray>
+#include <QCborMap>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QWriteLocker>
+
+#include "QJsonChannelCodec.h"
+
+namespace {
+
+class QJsonChannelJsonCodec : public QJsonChannelCodec {
+public:
+    QByteArray name () const override {
+        return "json";
+    }
+
+    bool decode (const QByteArray& data, QList<QJsonChannelMessage>* messages, bool* batch) const override {
+        *batch = false;
+
+        // a single message is scanned without building a document
+        QJsonChannelMessage message = QJsonChannelMessage::fromJson (data);
+        if (message.isValid ()) {
+            messages->append (message);
+            return true;
+        }
+
+        QJsonParseError     error;
+        const QJsonDocument document = QJsonDocument::fromJson (data, &error);
+        if (error.error != QJsonParseError::NoError)
+            return false;
+
+        if (document.isObject ()) {
+            messages->append (QJsonChannelMessage::fromObject (document.object ()));
+            return true;
+        }
+
+        *batch = true;
+        for (const QJsonValue& value : document.array ())
+            messages->append (QJsonChannelMessage::fromObject (value.toObject ()));
+        return true;
+    }
+
+    QByteArray encode (const QList<QJsonChannelMessage>& messages, bool batch) const override {
+        QByteArray buffer;
+        if (!batch) {
+            if (!messages.isEmpty ())
+                messages.first ().writeJson (buffer);
+            return buffer;
+        }
+
+        buffer += '[';
+        for (int i = 0; i < messages.size (); ++i) {
+            if (i)
+                buffer += ',';
+            messages.at (i).writeJson (buffer);
+        }
+        buffer += ']';
+        return buffer;
+    }
+};
+
+class QJsonChannelCborCodec : public QJsonChannelCodec {
+public:
+    QByteArray name () const override {
+        return "cbor";
+    }
+
+    bool decode (const QByteArray& data, QList<QJsonChannelMessage>* messages, bool* batch) const override {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor (data, &error);
+        if (error.error != QCborError::NoError)
+            return false;
+
+        *batch = value.isArray ();
+        if (!*batch) {
+            messages->append (QJsonChannelMessage::fromCbor (value));
+            return true;
+        }
+
+        for (const QCborValue& message : value.toArray ())
+            messages->append (QJsonChannelMessage::fromCbor (message));
+        return true;
+    }
+
+    QByteArray encode (const QList<QJsonChannelMessage>& messages, bool batch) const override {
+        if (!batch)
+            return messages.isEmpty () ? QByteArray () : messages.first ().toCbor ().toCbor ();
+
+        QCborArray array;
+        for (const QJsonChannelMessage& message : messages)
+            array.append (message.toCbor ());
+        return QCborValue (array).toCbor ();
+    }
+};
+
+struct QJsonChannelCodecRegistry {
+    QJsonChannelCodecRegistry () {
+        _codecs.insert (_json.name (), &_json);
+        _codecs.insert (_cbor.name (), &_cbor);
+    }
+    ~QJsonChannelCodecRegistry () {
+        qDeleteAll (_registered);
+    }
+
+    QJsonChannelJsonCodec                 _json;
+    QJsonChannelCborCodec                 _cbor;
+    QReadWriteLock                        _lock;
+    QHash<QByteArray, QJsonChannelCodec*> _codecs;
+    // replaced codecs stay alive, other threads may still use the pointers returned by find
+    QList<QJsonChannelCodec*> _registered;
+};
+
+Q_GLOBAL_STATIC (QJsonChannelCodecRegistry, codecRegistry)
+
+} // namespace
+
+QJsonChannelCodec::~QJsonChannelCodec () {
+}
+
+const QJsonChannelCodec* QJsonChannelCodec::json () {
+    return &codecRegistry ()->_json;
+}
+
+const QJsonChannelCodec* QJsonChannelCodec::cbor () {
+    return &codecRegistry ()->_cbor;
+}
+
+void QJsonChannelCodec::registerCodec (QJsonChannelCodec* codec) {
+    QJsonChannelCodecRegistry* registry = codecRegistry ();
+    QWriteLocker               lock (&registry->_lock);
+    if (!registry->_registered.contains (codec))
+        registry->_registered.append (codec);
+    registry->_codecs.insert (codec->name (), codec);
+}
+
+const QJsonChannelCodec* QJsonChannelCodec::find (const QByteArray& name) {
+    QJsonChannelCodecRegistry* registry = codecRegistry ();
+    QReadLocker                lock (&registry->_lock);
+    return registry->_codecs.value (name);
+}
+
+const QJsonChannelCodec* QJsonChannelCodec::negotiate (const QList<QByteArray>& offered) {
+    for (const QByteArray& name : offered) {
+        if (const QJsonChannelCodec* codec = find (name))
+            return codec;
+    }
+    return json ();
+}
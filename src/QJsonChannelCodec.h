@@ -0,0 +1,81 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+
+#include "QJsonChannelMessage.h"
+
+/**
+ * @brief Wire encoding of JSON-RPC messages. JSON and CBOR codecs are built in, more codecs can be registered.
+ * A channel negotiates the codec by name, its messages go through the same processing whatever the encoding is.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelCodec {
+public:
+    virtual ~QJsonChannelCodec ();
+
+    /**
+     * @brief Returns the codec name used by the negotiation ("json", "cbor")
+     *
+     * @return QByteArray
+     */
+    virtual QByteArray name () const = 0;
+
+    /**
+     * @brief Decodes a message or a batch of messages
+     *
+     * @param data Encoded data
+     * @param messages Receives the decoded messages
+     * @param batch Receives true if the data is a batch
+     * @return true The data was decoded
+     * @return false The data can't be parsed
+     */
+    virtual bool decode (const QByteArray& data, QList<QJsonChannelMessage>* messages, bool* batch) const = 0;
+
+    /**
+     * @brief Encodes a message or a batch of messages
+     *
+     * @param messages Messages to encode, exactly one if it's not a batch
+     * @param batch Encode the messages as a batch
+     * @return QByteArray Encoded data
+     */
+    virtual QByteArray encode (const QList<QJsonChannelMessage>& messages, bool batch) const = 0;
+
+    /**
+     * @brief Returns the built-in JSON codec
+     *
+     * @return const QJsonChannelCodec*
+     */
+    static const QJsonChannelCodec* json ();
+
+    /**
+     * @brief Returns the built-in CBOR codec, QByteArray parameters and return values are sent as byte strings
+     *
+     * @return const QJsonChannelCodec*
+     */
+    static const QJsonChannelCodec* cbor ();
+
+    /**
+     * @brief Registers a codec, the registry takes the codec ownership. A replaced codec is kept until the process exit,
+     * it may still be in use by other threads.
+     *
+     * @param codec Codec to register, replaces a codec with the same name
+     */
+    static void registerCodec (QJsonChannelCodec* codec);
+
+    /**
+     * @brief Returns the codec by name
+     *
+     * @param name Codec name
+     * @return const QJsonChannelCodec* The codec or nullptr if it's not registered
+     */
+    static const QJsonChannelCodec* find (const QByteArray& name);
+
+    /**
+     * @brief Picks the first codec offered by the peer which is registered
+     *
+     * @param offered Codec names in the order of the peer preference
+     * @return const QJsonChannelCodec* The codec, JSON codec if none of the offered codecs is registered
+     */
+    static const QJsonChannelCodec* negotiate (const QList<QByteArray>& offered);
+};
@@ -0,0 +1,203 @@
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include "QJsonChannelExecutor.h"
+#include "QJsonChannelGlobal.h"
+
+// executor whose task is running on the current thread
+static thread_local const QJsonChannelExecutor* currentExecutor = nullptr;
+
+namespace {
+
+class QJsonChannelDrainRunnable : public QRunnable {
+public:
+    explicit QJsonChannelDrainRunnable (const std::function<void ()>& drain) : _drain (drain) {
+    }
+
+    void run () override {
+        _drain ();
+    }
+
+private:
+    std::function<void ()> _drain;
+};
+
+} // namespace
+
+// held by the queued drains, the mutex is held while a queued drain runs
+struct QJsonChannelExecutor::DrainState {
+    QMutex                _mutex;
+    QJsonChannelExecutor* _executor = nullptr; // nullptr once the executor is destroyed
+};
+
+QJsonChannelExecutor::QJsonChannelExecutor (QThreadPool* pool)
+    : _tail (&_stub), _pool (pool ? pool : QThreadPool::globalInstance ()), _state (new DrainState) {
+    _head.storeRelease (&_stub);
+    _state->_executor = this;
+}
+
+QJsonChannelExecutor::QJsonChannelExecutor (QObject* context) : _tail (&_stub), _state (new DrainState), _drainer (new QObject) {
+    _head.storeRelease (&_stub);
+    _state->_executor = this;
+    _drainer->moveToThread (context->thread ());
+}
+
+QJsonChannelExecutor::~QJsonChannelExecutor () {
+    Q_ASSERT_X (currentExecutor != this, "QJsonChannelExecutor", "the executor can't be destroyed by its own task");
+
+    // the context thread is busy here and a queued pool drain may wait for a free thread, so the tasks are drained inline where possible
+    const bool    drainsInline = !_drainer || QThread::currentThread () == _drainer->thread ();
+    QElapsedTimer timer;
+    timer.start ();
+    while (_pending.loadAcquire () > 0 || _draining.loadAcquire ()) {
+        if (drainsInline)
+            drain ();
+        else if (timer.elapsed () >= drainTimeout)
+            break;
+        QThread::yieldCurrentThread ();
+    }
+
+    {
+        // waits for a queued drain still running, the later ones find no executor
+        QMutexLocker lock (&_state->_mutex);
+        _state->_executor = nullptr;
+    }
+
+    if (_pending.loadAcquire () > 0) {
+        QJsonChannelDebug () << Q_FUNC_INFO << _pending.loadAcquire () << "tasks dropped, the context thread runs no event loop";
+        discard ();
+    }
+
+    if (_drainer) {
+        // deleting the drainer in its thread discards the queued drain calls
+        if (QThread::currentThread () == _drainer->thread ())
+            delete _drainer;
+        else
+            _drainer->deleteLater ();
+    }
+}
+
+void QJsonChannelExecutor::post (const std::function<void ()>& task, const std::function<void ()>& drop) {
+    Task* node      = new Task;
+    node->_function = task;
+    node->_drop     = drop;
+    push (node);
+
+    // the drain in progress runs until the counter is zero, so only the first task wakes it up
+    if (_pending.fetchAndAddOrdered (1) == 0)
+        schedule ();
+}
+
+void QJsonChannelExecutor::invoke (const std::function<void ()>& task) {
+    QSemaphore done;
+    post ([&task, &done] () {
+        task ();
+        done.release ();
+    });
+
+    if (_drainer) {
+        done.acquire ();
+        return;
+    }
+
+    // the drain runnable may be queued behind the waiting threads of a busy pool
+    while (!done.tryAcquire (1, 1))
+        drain ();
+}
+
+bool QJsonChannelExecutor::isCurrent () const {
+    // every drain of a context executor runs in the context thread
+    return currentExecutor == this || (_drainer && QThread::currentThread () == _drainer->thread ());
+}
+
+void QJsonChannelExecutor::push (Task* task) {
+    task->_next.storeRelease (nullptr);
+    Task* previous = _head.fetchAndStoreOrdered (task);
+    previous->_next.storeRelease (task);
+}
+
+QJsonChannelExecutor::Task* QJsonChannelExecutor::pop () {
+    Task* tail = _tail;
+    Task* next = tail->_next.loadAcquire ();
+    if (tail == &_stub) {
+        if (!next)
+            return nullptr;
+        _tail = next;
+        tail  = next;
+        next  = next->_next.loadAcquire ();
+    }
+
+    if (next) {
+        _tail = next;
+        return tail;
+    }
+
+    // a producer has taken the head but hasn't linked it yet
+    if (tail != _head.loadAcquire ())
+        return nullptr;
+
+    push (&_stub);
+    next = tail->_next.loadAcquire ();
+    if (next) {
+        _tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+void QJsonChannelExecutor::schedule () {
+    QSharedPointer<DrainState> state = _state;
+    const auto                 drain = [state] () {
+        QMutexLocker lock (&state->_mutex);
+        if (state->_executor)
+            state->_executor->drain ();
+    };
+
+    if (_drainer)
+        QMetaObject::invokeMethod (_drainer, drain, Qt::QueuedConnection);
+    else
+        _pool->start (new QJsonChannelDrainRunnable (drain));
+}
+
+void QJsonChannelExecutor::drain () {
+    // a drain call queued before an inline drain finds nothing to do, a drain in progress runs the new tasks
+    while (_pending.loadAcquire () > 0 && _draining.testAndSetAcquire (0, 1)) {
+        const QJsonChannelExecutor* previous = currentExecutor;
+        currentExecutor                      = this;
+
+        while (_pending.loadAcquire () > 0) {
+            Task* task = pop ();
+            if (!task) {
+                // the task is counted, its producer is in the middle of push
+                QThread::yieldCurrentThread ();
+                continue;
+            }
+
+            task->_function ();
+            delete task;
+            _pending.fetchAndSubOrdered (1);
+        }
+
+        currentExecutor = previous;
+        // a task posted after the last check may have found the consumer side taken, the loop takes it again
+        _draining.storeRelease (0);
+    }
+}
+
+void QJsonChannelExecutor::discard () {
+    while (_pending.loadAcquire () > 0) {
+        Task* task = pop ();
+        if (!task)
+            break;
+        if (task->_drop)
+            task->_drop ();
+        delete task;
+        _pending.fetchAndSubOrdered (1);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QObject>
+#include <QSharedPointer>
+
+#include <functional>
+
+class QThreadPool;
+
+/**
+ * @brief Serial executor: tasks posted from any thread run one by one in the order of posting.
+ * The tasks are kept in a lock-free multi-producer single-consumer queue, which is drained either by a single
+ * thread pool worker or by the thread of a context object (the thread must run an event loop).
+ * Posting never blocks, a pool thread waiting for a task drains the queue by itself instead of holding a worker.
+ *
+ */
+class QJsonChannelExecutor {
+public:
+    /**
+     * @brief Construct an executor drained by a thread pool worker
+     *
+     * @param pool Thread pool, QThreadPool::globalInstance () if nullptr
+     */
+    explicit QJsonChannelExecutor (QThreadPool* pool);
+
+    /**
+     * @brief Construct an executor drained by the thread of the context object
+     *
+     * @param context Object whose thread runs the tasks
+     */
+    explicit QJsonChannelExecutor (QObject* context);
+
+    /**
+     * @brief Waits until all the posted tasks are run and no drain is in progress. The tasks which are not run
+     * within drainTimeout (the context thread runs no event loop) are dropped, their drop functions are called instead.
+     *
+     */
+    ~QJsonChannelExecutor ();
+
+    //! Maximum wait of the destructor for the posted tasks, in milliseconds
+    static const int drainTimeout = 5000;
+
+    /**
+     * @brief Queues a task, the first task posted to an idle executor schedules the draining
+     *
+     * @param task Task to run
+     * @param drop Called instead of the task if the executor is destroyed before the task is run
+     */
+    void post (const std::function<void ()>& task, const std::function<void ()>& drop = std::function<void ()> ());
+
+    /**
+     * @brief Queues a task and returns when it's run. A pool executor is drained by the waiting thread itself
+     * when no drain is running, so a waiting pool thread never holds back the drain it waits for.
+     *
+     * @param task Task to run
+     */
+    void invoke (const std::function<void ()>& task);
+
+    /**
+     * @brief Returns true if the calling thread runs the tasks of the executor, so a task may be run inline
+     * without breaking the serialization
+     *
+     */
+    bool isCurrent () const;
+
+private:
+    Q_DISABLE_COPY (QJsonChannelExecutor)
+
+    struct Task {
+        QAtomicPointer<Task>   _next;
+        std::function<void ()> _function;
+        std::function<void ()> _drop;
+    };
+    struct DrainState;
+
+    void  push (Task* task);
+    Task* pop ();
+    void  schedule ();
+    void  drain ();
+    void  discard ();
+
+    QAtomicPointer<Task> _head; // producers side
+    Task*                _tail; // consumer side
+    Task                 _stub;
+    QAtomicInt           _pending;  // tasks posted and not run yet
+    QAtomicInt           _draining; // the consumer side is taken by a draining thread
+
+    QThreadPool*               _pool    = nullptr;
+    QSharedPointer<DrainState> _state;            // the queued drains may start after the executor is gone
+    QObject*                   _drainer = nullptr; // lives in the context thread
+};
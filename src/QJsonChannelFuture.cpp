@@ -0,0 +1,72 @@
+#include <QHash>
+#include <QList>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QThread>
+#include <QWriteLocker>
+
+#include "QJsonChannelFuture.h"
+
+namespace {
+
+struct QJsonChannelFutureRegistry {
+    ~QJsonChannelFutureRegistry () {
+        qDeleteAll (_registered);
+    }
+
+    QReadWriteLock                         _lock;
+    QHash<int, QJsonChannelFutureAdapter*> _adapters;
+    // replaced adapters stay alive, registered methods keep the adapter pointers
+    QList<QJsonChannelFutureAdapter*> _registered;
+};
+
+Q_GLOBAL_STATIC (QJsonChannelFutureRegistry, futureRegistry)
+
+// Event loop of the watchers of the pending futures, any number of futures is watched by the single thread
+struct QJsonChannelFutureWatchers {
+    QJsonChannelFutureWatchers () {
+        _thread.setObjectName (QStringLiteral ("QJsonChannelFutureWatchers"));
+        _context.moveToThread (&_thread);
+        _thread.start ();
+    }
+    ~QJsonChannelFutureWatchers () {
+        _thread.quit ();
+        _thread.wait ();
+    }
+
+    QThread _thread;
+    QObject _context; // parent of the watchers, destroyed with them once the thread is stopped
+};
+
+Q_GLOBAL_STATIC (QJsonChannelFutureWatchers, futureWatchers)
+
+} // namespace
+
+QJsonChannelFutureAdapter::~QJsonChannelFutureAdapter () {
+}
+
+void QJsonChannelFutureAdapter::registerAdapter (int futureType, QJsonChannelFutureAdapter* adapter) {
+    QJsonChannelFutureRegistry* registry = futureRegistry ();
+    QWriteLocker                lock (&registry->_lock);
+    if (!registry->_registered.contains (adapter))
+        registry->_registered.append (adapter);
+    registry->_adapters.insert (futureType, adapter);
+}
+
+void QJsonChannelFutureAdapter::watch (const std::function<void (QObject* context)>& task) {
+    QJsonChannelFutureWatchers* watchers = futureWatchers ();
+    if (!watchers) {
+        // the watcher thread is gone while the statics are destroyed
+        task (nullptr);
+        return;
+    }
+
+    QObject* context = &watchers->_context;
+    QMetaObject::invokeMethod (context, [task, context] () { task (context); }, Qt::QueuedConnection);
+}
+
+const QJsonChannelFutureAdapter* QJsonChannelFutureAdapter::adapter (int type) {
+    QJsonChannelFutureRegistry* registry = futureRegistry ();
+    QReadLocker                 lock (&registry->_lock);
+    return registry->_adapters.value (type);
+}
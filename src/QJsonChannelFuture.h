@@ -0,0 +1,150 @@
+#pragma once
+
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QMetaObject>
+#include <QVariant>
+
+#include <functional>
+
+#include "QJsonChannelGlobal.h"
+
+/**
+ * @brief Type-erased access to QFuture<T> values returned by service methods.
+ * Service methods returning a registered QFuture<T> are completed when the future is finished.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelFutureAdapter {
+public:
+    virtual ~QJsonChannelFutureAdapter ();
+
+    /**
+     * @brief Waits for the future and returns its result
+     *
+     * @param future Pointer to QFuture<T>
+     * @return QVariant The future result, invalid if the future has no result
+     */
+    virtual QVariant wait (const void* future) const = 0;
+
+    /**
+     * @brief Calls the completion with the future result as soon as the future is finished.
+     * A finished future is completed in the calling thread, otherwise the future is watched by the watcher thread of the library
+     * which calls the completion, neither an application object nor an event loop is needed and no thread waits for the future.
+     *
+     * @param future Pointer to QFuture<T>
+     * @param completion Function to be called with the future result
+     */
+    virtual void then (const void* future, const std::function<void (const QVariant&)>& completion) const = 0;
+
+    /**
+     * @brief Registers an adapter for a future meta type, the registry takes the adapter ownership.
+     * A replaced adapter stays alive until the library is unloaded, methods registered before still use it.
+     *
+     * @param futureType Meta type id of QFuture<T>
+     * @param adapter Adapter for the type
+     */
+    static void registerAdapter (int futureType, QJsonChannelFutureAdapter* adapter);
+
+    /**
+     * @brief Returns the adapter registered for a meta type
+     *
+     * @param type Meta type id
+     * @return const QJsonChannelFutureAdapter* The adapter or nullptr if the type is not a registered future
+     */
+    static const QJsonChannelFutureAdapter* adapter (int type);
+
+protected:
+    /**
+     * @brief Runs a task in the watcher thread, which runs an event loop for the future watchers.
+     * The calling worker thread is released immediately.
+     *
+     * @param task Creates a watcher, the context object lives in the watcher thread and may be the watcher parent,
+     * it is null when the watcher thread is gone and the task has to wait itself
+     */
+    static void watch (const std::function<void (QObject* context)>& task);
+};
+
+template <typename T>
+class QJsonChannelFutureAdapterT : public QJsonChannelFutureAdapter {
+public:
+    QVariant wait (const void* future) const override {
+        QFuture<T> f = *static_cast<const QFuture<T>*> (future);
+        f.waitForFinished ();
+        return result (f);
+    }
+
+    void then (const void* future, const std::function<void (const QVariant&)>& completion) const override {
+        QFuture<T> f = *static_cast<const QFuture<T>*> (future);
+        if (f.isFinished ()) {
+            completion (result (f));
+            return;
+        }
+
+        watch ([f, completion] (QObject* context) mutable {
+            if (!context) {
+                // no watcher thread while the statics are destroyed
+                f.waitForFinished ();
+                completion (result (f));
+                return;
+            }
+            QFutureWatcher<T>* watcher = new QFutureWatcher<T> (context);
+            QObject::connect (watcher, &QFutureWatcherBase::finished, watcher, [watcher, completion] () {
+                completion (result (watcher->future ()));
+                watcher->deleteLater ();
+            });
+            watcher->setFuture (f);
+        });
+    }
+
+private:
+    static QVariant result (const QFuture<T>& future) {
+        if (future.resultCount () == 0)
+            return QVariant ();
+        return QVariant::fromValue (future.result ());
+    }
+};
+
+template <>
+class QJsonChannelFutureAdapterT<void> : public QJsonChannelFutureAdapter {
+public:
+    QVariant wait (const void* future) const override {
+        QFuture<void> f = *static_cast<const QFuture<void>*> (future);
+        f.waitForFinished ();
+        return QVariant ();
+    }
+
+    void then (const void* future, const std::function<void (const QVariant&)>& completion) const override {
+        QFuture<void> f = *static_cast<const QFuture<void>*> (future);
+        if (f.isFinished ()) {
+            completion (QVariant ());
+            return;
+        }
+
+        watch ([f, completion] (QObject* context) mutable {
+            if (!context) {
+                // no watcher thread while the statics are destroyed
+                f.waitForFinished ();
+                completion (QVariant ());
+                return;
+            }
+            QFutureWatcher<void>* watcher = new QFutureWatcher<void> (context);
+            QObject::connect (watcher, &QFutureWatcherBase::finished, watcher, [watcher, completion] () {
+                completion (QVariant ());
+                watcher->deleteLater ();
+            });
+            watcher->setFuture (f);
+        });
+    }
+};
+
+/**
+ * @brief Allows service methods to return QFuture<T>. Should be called before the services are added.
+ *
+ */
+template <typename T>
+inline void qJsonChannelRegisterFuture () {
+    // QFuture<T> has no automatic meta type, it's registered by the name moc uses for method signatures
+    const QByteArray name = QMetaObject::normalizedType ("QFuture<" + QByteArray (QMetaType::typeName (qMetaTypeId<T> ())) + ">");
+    int              type = qRegisterMetaType<QFuture<T>> (name.constData ());
+    QJsonChannelFutureAdapter::registerAdapter (type, new QJsonChannelFutureAdapterT<T>);
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <QtGlobal>
+#include <QByteArray>
 #include <QMetaType>
 #include "QJsonChannelCore_export.h"
 
@@ -21,4 +22,10 @@ namespace QJsonChannel {
 }
 Q_DECLARE_METATYPE(QJsonChannel::ErrorCode)
 
-#define QJsonChannelDebug if (qgetenv("QJsonChannel_DEBUG").isEmpty()); else qDebug
\ No newline at end of file
+// the environment is read once, the debug output of the hot paths costs a flag check
+inline bool qJsonChannelDebugEnabled () {
+    static const bool enabled = !qgetenv ("QJsonChannel_DEBUG").isEmpty ();
+    return enabled;
+}
+
+#define QJsonChannelDebug if (!qJsonChannelDebugEnabled ()); else qDebug
\ No newline at end of file
@@ -1,45 +1,361 @@
 #include <QDebug>
 
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QCborArray>
+#include <QCborMap>
 #include <QJsonDocument>
+#include <QLocale>
+#include <QThread>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
 
 #include "QJsonChannelMessage.h"
 
+// Value constructed on demand inside the block of its owner, concurrent readers wait for the first constructor
+template <typename T>
+class QJsonChannelLazyValue
+{
+public:
+    QJsonChannelLazyValue() {}
+    ~QJsonChannelLazyValue() { reset(); }
+
+    template <typename Create>
+    const T &get(Create create) const
+    {
+        if (state.loadAcquire() != Ready) {
+            if (state.testAndSetAcquire(Empty, Creating)) {
+                new (&storage) T(create());
+                state.storeRelease(Ready);
+            } else {
+                while (state.loadAcquire() != Ready)
+                    QThread::yieldCurrentThread();
+            }
+        }
+        return *reinterpret_cast<const T *>(&storage);
+    }
+
+    // not thread safe, called by the owner only
+    void reset()
+    {
+        if (state.loadAcquire() == Ready)
+            reinterpret_cast<T *>(&storage)->~T();
+        state.storeRelease(Empty);
+    }
+
+private:
+    Q_DISABLE_COPY(QJsonChannelLazyValue)
+
+    enum { Empty, Creating, Ready };
+    mutable QAtomicInt state;
+    mutable typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+};
+
 class QJsonChannelMessagePrivate : public QSharedData
 {
 public:
+    // the blocks are recycled by per-thread pools
+    static void *operator new(size_t size);
+    static void operator delete(void *block, size_t size);
+
     QJsonChannelMessagePrivate();
     ~QJsonChannelMessagePrivate();
     QJsonChannelMessagePrivate(const QJsonChannelMessagePrivate &other);
 
     void initializeWithObject(const QJsonObject &message);
+    bool initializeWithData(const QByteArray &message);
     static QJsonChannelMessage createBasicRequest(const QString &method, const QJsonArray &params);
     static QJsonChannelMessage createBasicRequest(const QString &method,
                                               const QJsonObject &namedParameters);
 
+    const QJsonObject &envelope() const;
+    QJsonObject *mutableEnvelope();
+    QJsonObject composeEnvelope() const;
+    QJsonValue composedResult() const;
+    QJsonValue lazyParams() const;
+    void writeEnvelope(QByteArray &buffer) const;
+
     QJsonChannelMessage::Type type;
-    QScopedPointer<QJsonObject> object;
+    // the whole message, built on demand for messages created from JSON data
+    mutable QAtomicPointer<QJsonObject> object;
+    QByteArray methodPath;
+    QJsonValue id;
+
+    // messages created from JSON data refer to the source data instead of building a DOM
+    QByteArray data;
+    QByteArray paramsData;
+    QJsonChannelLazyValue<QJsonValue> paramsValue;
 
-    static int uniqueRequestCounter;
+    // responses and errors are composed from the fields, the envelope object is built only on demand
+    bool composed;
+    QJsonValue result;
+    // already serialized result, written as is
+    QByteArray resultData;
+    // result with binary values, converted to JSON on demand
+    QCborValue cborResult;
+
+    // the whole message decoded from CBOR, byte strings are kept as is
+    QCborValue cbor;
+    int errorCode;
+    QString errorMessage;
+    QJsonValue errorData;
+    // serialized envelope of a standard error up to the id, the id is spliced in
+    const QByteArray *errorPrefix;
+
+    static qint64 nextRequestId();
 };
 
-int QJsonChannelMessagePrivate::uniqueRequestCounter = 0;
+// Request ids are handed out from per-thread blocks, the shared counter is touched once per block.
+// The ids are numbers of QJsonValue, a double, so the sequence wraps around at 2^53 before it loses precision.
+static const qint64 requestIdBlockSize = 1024;
+static const qint64 maxRequestId = Q_INT64_C(1) << 53;
+static QAtomicInteger<qint64> requestIdBlocks;
+
+qint64 QJsonChannelMessagePrivate::nextRequestId()
+{
+    static thread_local qint64 next = 0;
+    static thread_local qint64 end = 0;
+    if (next == end) {
+        // maxRequestId is a multiple of the block size, so a block never crosses it
+        next = requestIdBlocks.fetchAndAddRelaxed(requestIdBlockSize) % maxRequestId + 1;
+        end = next + requestIdBlockSize;
+    }
+    return next++;
+}
+
+template <typename T, typename Create>
+static T *lazyCreate(QAtomicPointer<T> &pointer, Create create)
+{
+    T *current = pointer.loadAcquire();
+    if (current)
+        return current;
+
+    T *created = new T(create());
+    if (pointer.testAndSetOrdered(0, created))
+        return created;
+
+    // another thread was faster
+    delete created;
+    return pointer.loadAcquire();
+}
+
+// QJsonDocument accepts only objects and arrays as a root, so scalars are wrapped into an array
+static QJsonValue parseValue(const QByteArray &data)
+{
+    if (data.startsWith('{') || data.startsWith('[')) {
+        const QJsonDocument document = QJsonDocument::fromJson(data);
+        if (document.isObject())
+            return document.object();
+        if (document.isArray())
+            return document.array();
+        return QJsonValue(QJsonValue::Undefined);
+    }
+
+    return QJsonDocument::fromJson('[' + data + ']').array().at(0);
+}
+
+// Single pass JSON validation, the scanners advance pos behind the scanned token
+static const int maxNestingDepth = 1024;
+
+static inline void skipWhitespace(const char *&pos, const char *end)
+{
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+        ++pos;
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline bool isHexDigit(char c)
+{
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool skipString(const char *&pos, const char *end, bool *escaped = 0)
+{
+    if (pos >= end || *pos != '"')
+        return false;
+
+    ++pos;
+    while (pos < end) {
+        const char c = *pos++;
+        if (c == '"')
+            return true;
+
+        if (static_cast<unsigned char>(c) < 0x20)
+            return false;
+
+        if (c == '\\') {
+            if (escaped)
+                *escaped = true;
+            if (pos >= end)
+                return false;
+
+            switch (*pos++) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                break;
+            case 'u':
+                for (int i = 0; i < 4; ++i, ++pos) {
+                    if (pos >= end || !isHexDigit(*pos))
+                        return false;
+                }
+                break;
+            default:
+                return false;
+            }
+        }
+    }
+
+    return false;
+}
+
+static bool skipDigits(const char *&pos, const char *end)
+{
+    const char *start = pos;
+    while (pos < end && isDigit(*pos))
+        ++pos;
+    return pos != start;
+}
+
+static bool skipNumber(const char *&pos, const char *end)
+{
+    if (pos < end && *pos == '-')
+        ++pos;
+
+    if (pos < end && *pos == '0')
+        ++pos;
+    else if (!skipDigits(pos, end))
+        return false;
+
+    if (pos < end && *pos == '.') {
+        ++pos;
+        if (!skipDigits(pos, end))
+            return false;
+    }
+
+    if (pos < end && (*pos == 'e' || *pos == 'E')) {
+        ++pos;
+        if (pos < end && (*pos == '+' || *pos == '-'))
+            ++pos;
+        if (!skipDigits(pos, end))
+            return false;
+    }
+
+    return true;
+}
+
+static bool skipLiteral(const char *&pos, const char *end, const char *literal, int size)
+{
+    if (end - pos < size || memcmp(pos, literal, size) != 0)
+        return false;
+
+    pos += size;
+    return true;
+}
+
+static bool skipValue(const char *&pos, const char *end, int depth)
+{
+    if (depth > maxNestingDepth)
+        return false;
+
+    skipWhitespace(pos, end);
+    if (pos >= end)
+        return false;
+
+    switch (*pos) {
+    case '"':
+        return skipString(pos, end);
+    case '{':
+    case '[': {
+        const char close = (*pos == '{') ? '}' : ']';
+        const bool isObject = (close == '}');
+        ++pos;
+        skipWhitespace(pos, end);
+        if (pos < end && *pos == close) {
+            ++pos;
+            return true;
+        }
+
+        forever {
+            if (isObject) {
+                skipWhitespace(pos, end);
+                if (!skipString(pos, end))
+                    return false;
+                skipWhitespace(pos, end);
+                if (pos >= end || *pos != ':')
+                    return false;
+                ++pos;
+            }
+
+            if (!skipValue(pos, end, depth + 1))
+                return false;
+
+            skipWhitespace(pos, end);
+            if (pos >= end)
+                return false;
+            if (*pos == close) {
+                ++pos;
+                return true;
+            }
+            if (*pos != ',')
+                return false;
+            ++pos;
+        }
+    }
+    case 't':
+        return skipLiteral(pos, end, "true", 4);
+    case 'f':
+        return skipLiteral(pos, end, "false", 5);
+    case 'n':
+        return skipLiteral(pos, end, "null", 4);
+    default:
+        return skipNumber(pos, end);
+    }
+}
 
 QJsonChannelMessagePrivate::QJsonChannelMessagePrivate()
     : type(QJsonChannelMessage::Invalid),
-      object(0)
+      object(0),
+      id(QJsonValue::Undefined),
+      composed(false),
+      result(QJsonValue::Undefined),
+      errorCode(0),
+      errorData(QJsonValue::Undefined),
+      errorPrefix(0)
 {
 }
 
 QJsonChannelMessagePrivate::QJsonChannelMessagePrivate(const QJsonChannelMessagePrivate &other)
     : QSharedData(other),
       type(other.type),
-      object(other.object ? new QJsonObject(*other.object) : 0)
+      object(other.object.loadAcquire() ? new QJsonObject(*other.object.loadAcquire()) : 0),
+      methodPath(other.methodPath),
+      id(other.id),
+      data(other.data),
+      paramsData(other.paramsData),
+      composed(other.composed),
+      result(other.result),
+      resultData(other.resultData),
+      cborResult(other.cborResult),
+      cbor(other.cbor),
+      errorCode(other.errorCode),
+      errorMessage(other.errorMessage),
+      errorData(other.errorData),
+      errorPrefix(other.errorPrefix)
 {
 }
 
 void QJsonChannelMessagePrivate::initializeWithObject(const QJsonObject &message)
 {
-    object.reset(new QJsonObject(message));
+    delete object.fetchAndStoreOrdered(new QJsonObject(message));
+    methodPath = message.value(QLatin1String("method")).toString().toUtf8();
+    id = message.value(QLatin1String("id"));
     if (message.contains(QLatin1String("id"))) {
         if (message.contains(QLatin1String("result")) ||
             message.contains(QLatin1String("error"))) {
@@ -61,14 +377,419 @@ void QJsonChannelMessagePrivate::initializeWithObject(const QJsonObject &message
     }
 }
 
+bool QJsonChannelMessagePrivate::initializeWithData(const QByteArray &message)
+{
+    // the params slice refers to the data kept by the message, so raw data (no allocation of its own) is copied
+    const QByteArray source = message.capacity() == 0 ? QByteArray(message.constData(), message.size()) : message;
+    const char *pos = source.constData();
+    const char *end = pos + source.size();
+
+    bool hasId = false;
+    bool hasMethod = false;
+    bool hasResult = false;
+    bool hasError = false;
+    bool errorIsNull = false;
+    QJsonValue messageId(QJsonValue::Undefined);
+    QByteArray messageMethod;
+    QByteArray messageParams;
+
+    skipWhitespace(pos, end);
+    if (pos >= end || *pos != '{')
+        return false;
+    ++pos;
+    skipWhitespace(pos, end);
+
+    if (pos < end && *pos == '}') {
+        ++pos;
+    } else {
+        forever {
+            skipWhitespace(pos, end);
+            const char *keyBegin = pos;
+            bool keyEscaped = false;
+            if (!skipString(pos, end, &keyEscaped))
+                return false;
+            const QByteArray key = keyEscaped
+                ? parseValue(QByteArray::fromRawData(keyBegin, pos - keyBegin)).toString().toUtf8()
+                : QByteArray::fromRawData(keyBegin + 1, pos - keyBegin - 2);
+
+            skipWhitespace(pos, end);
+            if (pos >= end || *pos != ':')
+                return false;
+            ++pos;
+            skipWhitespace(pos, end);
+
+            const char *valueBegin = pos;
+            bool valueEscaped = false;
+            if (pos < end && *pos == '"') {
+                if (!skipString(pos, end, &valueEscaped))
+                    return false;
+            } else if (!skipValue(pos, end, 1)) {
+                return false;
+            }
+            const QByteArray value = QByteArray::fromRawData(valueBegin, pos - valueBegin);
+
+            if (key == "id") {
+                hasId = true;
+                if (*valueBegin == '"' && !valueEscaped)
+                    messageId = QString::fromUtf8(valueBegin + 1, value.size() - 2);
+                else
+                    messageId = parseValue(value);
+            } else if (key == "method") {
+                hasMethod = true;
+                if (*valueBegin != '"')
+                    messageMethod.clear();
+                else if (valueEscaped)
+                    messageMethod = parseValue(value).toString().toUtf8();
+                else
+                    // the method path leaves the message (metrics keys, dispatch), so it owns its bytes
+                    messageMethod = QByteArray(valueBegin + 1, value.size() - 2);
+            } else if (key == "params") {
+                messageParams = value;
+            } else if (key == "result") {
+                hasResult = true;
+            } else if (key == "error") {
+                hasError = true;
+                errorIsNull = (value == "null");
+            }
+
+            skipWhitespace(pos, end);
+            if (pos >= end)
+                return false;
+            if (*pos == '}') {
+                ++pos;
+                break;
+            }
+            if (*pos != ',')
+                return false;
+            ++pos;
+        }
+    }
+
+    skipWhitespace(pos, end);
+    if (pos != end)
+        return false;
+
+    if (hasId) {
+        if (hasResult || hasError) {
+            if (hasError && !errorIsNull)
+                type = QJsonChannelMessage::Error;
+            else
+                type = QJsonChannelMessage::Response;
+        } else if (hasMethod) {
+            if (messageMethod == "__init__")
+                type = QJsonChannelMessage::Discrovery;
+            else
+                type = QJsonChannelMessage::Request;
+        }
+    } else {
+        if (hasMethod)
+            type = QJsonChannelMessage::Notification;
+    }
+
+    // the params slice refers to the data which is kept by the message
+    data = source;
+    methodPath = messageMethod;
+    id = messageId;
+    paramsData = messageParams;
+    delete object.fetchAndStoreOrdered(0);
+    paramsValue.reset();
+    return true;
+}
+
+const QJsonObject &QJsonChannelMessagePrivate::envelope() const
+{
+    return *lazyCreate(object, [this]() {
+        if (composed)
+            return composeEnvelope();
+        if (cbor.isMap())
+            return cbor.toMap().toJsonObject();
+        if (data.isNull())
+            return QJsonObject();
+        return QJsonDocument::fromJson(data).object();
+    });
+}
+
+QJsonValue QJsonChannelMessagePrivate::composedResult() const
+{
+    if (!resultData.isNull())
+        return parseValue(resultData);
+    if (!cborResult.isUndefined())
+        return cborResult.toJsonValue();
+    return result;
+}
+
+QJsonObject QJsonChannelMessagePrivate::composeEnvelope() const
+{
+    QJsonObject message;
+    message.insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
+    message.insert(QLatin1String("id"), id);
+    if (type == QJsonChannelMessage::Error) {
+        QJsonObject error;
+        error.insert(QLatin1String("code"), errorCode);
+        if (!errorMessage.isEmpty())
+            error.insert(QLatin1String("message"), errorMessage);
+        if (!errorData.isUndefined())
+            error.insert(QLatin1String("data"), errorData);
+        message.insert(QLatin1String("error"), error);
+    } else {
+        message.insert(QLatin1String("result"), composedResult());
+    }
+    return message;
+}
+
+// Compact JSON writer, keys are written in the QJsonObject order so the output matches QJsonDocument::Compact
+static void writeValue(QByteArray &buffer, const QJsonValue &value);
+
+static void writeString(QByteArray &buffer, const QString &string)
+{
+    const QByteArray utf8 = string.toUtf8();
+    const char *begin = utf8.constData();
+    const char *end = begin + utf8.size();
+
+    buffer += '"';
+    const char *run = begin;
+    for (const char *pos = begin; pos < end; ++pos) {
+        const unsigned char c = static_cast<unsigned char>(*pos);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        buffer.append(run, pos - run);
+        run = pos + 1;
+        switch (c) {
+        case '"': buffer += "\\\""; break;
+        case '\\': buffer += "\\\\"; break;
+        case '\b': buffer += "\\b"; break;
+        case '\f': buffer += "\\f"; break;
+        case '\n': buffer += "\\n"; break;
+        case '\r': buffer += "\\r"; break;
+        case '\t': buffer += "\\t"; break;
+        default: {
+            char escaped[8];
+            buffer.append(escaped, qsnprintf(escaped, sizeof(escaped), "\\u%04x", c));
+        }
+        }
+    }
+    buffer.append(run, end - run);
+    buffer += '"';
+}
+
+static void writeNumber(QByteArray &buffer, double value)
+{
+    // JSON has no representation for infinity and NaN
+    if (!qIsFinite(value)) {
+        buffer += "null";
+        return;
+    }
+
+    // integers up to 2^53 are exact in double and written without exponent
+    if (value == std::floor(value) && qAbs(value) < 9007199254740992.0) {
+        char number[24];
+        buffer.append(number, qsnprintf(number, sizeof(number), "%lld", static_cast<long long>(value)));
+        return;
+    }
+
+    buffer += QByteArray::number(value, 'g', QLocale::FloatingPointShortest);
+}
+
+static void writeValue(QByteArray &buffer, const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Bool:
+        buffer += value.toBool() ? "true" : "false";
+        break;
+    case QJsonValue::Double:
+        writeNumber(buffer, value.toDouble());
+        break;
+    case QJsonValue::String:
+        writeString(buffer, value.toString());
+        break;
+    case QJsonValue::Array: {
+        const QJsonArray array = value.toArray();
+        buffer += '[';
+        for (int i = 0; i < array.size(); ++i) {
+            if (i)
+                buffer += ',';
+            writeValue(buffer, array.at(i));
+        }
+        buffer += ']';
+        break;
+    }
+    case QJsonValue::Object: {
+        const QJsonObject object = value.toObject();
+        buffer += '{';
+        for (auto it = object.constBegin(); it != object.constEnd(); ++it) {
+            if (it != object.constBegin())
+                buffer += ',';
+            writeString(buffer, it.key());
+            buffer += ':';
+            writeValue(buffer, it.value());
+        }
+        buffer += '}';
+        break;
+    }
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+    default:
+        buffer += "null";
+        break;
+    }
+}
+
+void QJsonChannelMessagePrivate::writeEnvelope(QByteArray &buffer) const
+{
+    if (!composed) {
+        writeValue(buffer, envelope());
+        return;
+    }
+
+    if (type == QJsonChannelMessage::Error && errorPrefix) {
+        buffer += *errorPrefix;
+        writeValue(buffer, id);
+        buffer += ",\"jsonrpc\":\"2.0\"}";
+        return;
+    }
+
+    // the keys are in the order of QJsonObject: error, id, jsonrpc, result
+    buffer += '{';
+    if (type == QJsonChannelMessage::Error) {
+        buffer += "\"error\":{\"code\":";
+        writeNumber(buffer, errorCode);
+        if (!errorData.isUndefined()) {
+            buffer += ",\"data\":";
+            writeValue(buffer, errorData);
+        }
+        if (!errorMessage.isEmpty()) {
+            buffer += ",\"message\":";
+            writeString(buffer, errorMessage);
+        }
+        buffer += "},";
+    }
+
+    buffer += "\"id\":";
+    writeValue(buffer, id);
+    buffer += ",\"jsonrpc\":\"2.0\"";
+    if (type != QJsonChannelMessage::Error && !resultData.isNull()) {
+        buffer += ",\"result\":";
+        buffer += resultData;
+    } else if (type != QJsonChannelMessage::Error && !cborResult.isUndefined()) {
+        buffer += ",\"result\":";
+        writeValue(buffer, cborResult.toJsonValue());
+    } else if (type != QJsonChannelMessage::Error && !result.isUndefined()) {
+        buffer += ",\"result\":";
+        writeValue(buffer, result);
+    }
+    buffer += '}';
+}
+
+QJsonObject *QJsonChannelMessagePrivate::mutableEnvelope()
+{
+    envelope();
+    return object.loadAcquire();
+}
+
+QJsonValue QJsonChannelMessagePrivate::lazyParams() const
+{
+    if (cbor.isMap() && !object.loadAcquire()) {
+        return paramsValue.get([this]() {
+            return cbor.toMap().value(QLatin1String("params")).toJsonValue();
+        });
+    }
+    if (object.loadAcquire() || data.isNull())
+        return envelope().value(QLatin1String("params"));
+    if (paramsData.isNull())
+        return QJsonValue(QJsonValue::Undefined);
+
+    return paramsValue.get([this]() {
+        return parseValue(paramsData);
+    });
+}
+
 QJsonChannelMessagePrivate::~QJsonChannelMessagePrivate()
 {
+    delete object.loadAcquire();
+}
+
+// Free blocks of the message data cached by a thread. A block freed by another thread joins the cache of that thread.
+class QJsonChannelMessagePool
+{
+public:
+    static const int maxFreeBlocks = 256;
+
+    QJsonChannelMessagePool() { alive = true; }
+    ~QJsonChannelMessagePool()
+    {
+        alive = false;
+        while (freeBlocks) {
+            Block *block = freeBlocks;
+            freeBlocks = block->next;
+            ::operator delete(block);
+        }
+    }
+
+    static QJsonChannelMessagePool *instance()
+    {
+        // the pool of an exiting thread is gone, its blocks go to the heap
+        static thread_local QJsonChannelMessagePool pool;
+        return alive ? &pool : nullptr;
+    }
+
+    void *allocate()
+    {
+        if (!freeBlocks)
+            return ::operator new(sizeof(QJsonChannelMessagePrivate));
+
+        Block *block = freeBlocks;
+        freeBlocks = block->next;
+        --freeCount;
+        return block;
+    }
+
+    void release(void *memory)
+    {
+        if (freeCount == maxFreeBlocks) {
+            ::operator delete(memory);
+            return;
+        }
+
+        Block *block = static_cast<Block *>(memory);
+        block->next = freeBlocks;
+        freeBlocks = block;
+        ++freeCount;
+    }
+
+private:
+    struct Block {
+        Block *next;
+    };
+
+    Block *freeBlocks = nullptr;
+    int freeCount = 0;
+    static thread_local bool alive;
+};
+
+thread_local bool QJsonChannelMessagePool::alive = false;
+
+void *QJsonChannelMessagePrivate::operator new(size_t size)
+{
+    QJsonChannelMessagePool *pool = QJsonChannelMessagePool::instance();
+    if (size != sizeof(QJsonChannelMessagePrivate) || !pool)
+        return ::operator new(size);
+    return pool->allocate();
+}
+
+void QJsonChannelMessagePrivate::operator delete(void *block, size_t size)
+{
+    QJsonChannelMessagePool *pool = QJsonChannelMessagePool::instance();
+    if (size != sizeof(QJsonChannelMessagePrivate) || !pool) {
+        ::operator delete(block);
+        return;
+    }
+    pool->release(block);
 }
 
 QJsonChannelMessage::QJsonChannelMessage()
     : d(new QJsonChannelMessagePrivate)
 {
-    d->object.reset(new QJsonObject);
 }
 
 QJsonChannelMessage::QJsonChannelMessage(const QJsonChannelMessage &other)
@@ -101,7 +822,7 @@ bool QJsonChannelMessage::operator==(const QJsonChannelMessage &message) const
                 return (message.method() == method() &&
                         message.params() == params());
             } else {
-                return (message.id() == id() &&
+                return (message.idValue() == idValue() &&
                         message.method() == method() &&
                         message.params() == params());
             }
@@ -114,19 +835,11 @@ bool QJsonChannelMessage::operator==(const QJsonChannelMessage &message) const
 QJsonChannelMessage QJsonChannelMessage::fromJson(const QByteArray &message)
 {
     QJsonChannelMessage result;
-    QJsonParseError error;
-    QJsonDocument document = QJsonDocument::fromJson(message, &error);
-    if (error.error != QJsonParseError::NoError) {
-        QJsonChannelDebug() << Q_FUNC_INFO << error.errorString();
-        return result;
-    }
-
-    if (!document.isObject()) {
+    if (!result.d->initializeWithData(message)) {
         QJsonChannelDebug() << Q_FUNC_INFO << "invalid message: " << message;
         return result;
     }
 
-    result.d->initializeWithObject(document.object());
     return result;
 }
 
@@ -137,21 +850,82 @@ QJsonChannelMessage QJsonChannelMessage::fromObject(const QJsonObject &message)
     return result;
 }
 
+QJsonChannelMessage QJsonChannelMessage::fromCbor(const QCborValue &message)
+{
+    QJsonChannelMessage result;
+    if (!message.isMap()) {
+        QJsonChannelDebug() << Q_FUNC_INFO << "invalid message: " << message;
+        return result;
+    }
+
+    // the params stay CBOR, byte strings are converted to base64 text only for a JSON view of the message
+    QCborMap envelope = message.toMap();
+    envelope.remove(QLatin1String("params"));
+    result.d->initializeWithObject(envelope.toJsonObject());
+    delete result.d->object.fetchAndStoreOrdered(0);
+    result.d->cbor = message;
+    return result;
+}
+
+QCborValue QJsonChannelMessage::toCbor() const
+{
+    if (d->cbor.isMap())
+        return d->cbor;
+    if (!d->composed)
+        return QCborMap::fromJsonObject(d->envelope());
+
+    QCborMap message;
+    message.insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
+    message.insert(QLatin1String("id"), QCborValue::fromJsonValue(d->id));
+    if (d->type == QJsonChannelMessage::Error) {
+        QCborMap error;
+        error.insert(QLatin1String("code"), d->errorCode);
+        if (!d->errorMessage.isEmpty())
+            error.insert(QLatin1String("message"), d->errorMessage);
+        if (!d->errorData.isUndefined())
+            error.insert(QLatin1String("data"), QCborValue::fromJsonValue(d->errorData));
+        message.insert(QLatin1String("error"), error);
+    } else if (!d->cborResult.isUndefined()) {
+        message.insert(QLatin1String("result"), d->cborResult);
+    } else {
+        message.insert(QLatin1String("result"), QCborValue::fromJsonValue(d->composedResult()));
+    }
+    return message;
+}
+
+QCborValue QJsonChannelMessage::cborParams() const
+{
+    if (!d->cbor.isMap() || (d->type != QJsonChannelMessage::Request && d->type != QJsonChannelMessage::Notification))
+        return QCborValue();
+
+    return d->cbor.toMap().value(QLatin1String("params"));
+}
+
+bool QJsonChannelMessage::isCbor() const
+{
+    return d->cbor.isMap();
+}
+
 QJsonObject QJsonChannelMessage::toObject() const
 {
-    if (d->object)
-        return QJsonObject(*d->object);
-    return QJsonObject();
+    return d->envelope();
 }
 
-QByteArray QJsonChannelMessage::toJson() const
+QByteArray QJsonChannelMessage::toJson(QJsonDocument::JsonFormat format) const
 {
-    if (d->object) {
-        QJsonDocument doc(*d->object);
-        return doc.toJson();
+    if (format == QJsonDocument::Compact) {
+        QByteArray buffer;
+        d->writeEnvelope(buffer);
+        return buffer;
     }
 
-    return QByteArray();
+    QJsonDocument doc(d->envelope());
+    return doc.toJson(format);
+}
+
+void QJsonChannelMessage::writeJson(QByteArray &buffer) const
+{
+    d->writeEnvelope(buffer);
 }
 
 bool QJsonChannelMessage::isValid() const
@@ -167,10 +941,11 @@ QJsonChannelMessage::Type QJsonChannelMessage::type() const
 QJsonChannelMessage QJsonChannelMessagePrivate::createBasicRequest(const QString &method, const QJsonArray &params)
 {
     QJsonChannelMessage request;
-    request.d->object->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
-    request.d->object->insert(QLatin1String("method"), method);
+    request.d->mutableEnvelope()->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
+    request.d->mutableEnvelope()->insert(QLatin1String("method"), method);
+    request.d->methodPath = method.toUtf8();
     if (!params.isEmpty())
-        request.d->object->insert(QLatin1String("params"), params);
+        request.d->mutableEnvelope()->insert(QLatin1String("params"), params);
     return request;
 }
 
@@ -178,10 +953,11 @@ QJsonChannelMessage QJsonChannelMessagePrivate::createBasicRequest(const QString
                                                            const QJsonObject &namedParameters)
 {
     QJsonChannelMessage request;
-    request.d->object->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
-    request.d->object->insert(QLatin1String("method"), method);
+    request.d->mutableEnvelope()->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
+    request.d->mutableEnvelope()->insert(QLatin1String("method"), method);
+    request.d->methodPath = method.toUtf8();
     if (!namedParameters.isEmpty())
-        request.d->object->insert(QLatin1String("params"), namedParameters);
+        request.d->mutableEnvelope()->insert(QLatin1String("params"), namedParameters);
     return request;
 }
 
@@ -189,8 +965,8 @@ QJsonChannelMessage QJsonChannelMessage::createRequest(const QString &method, co
 {
     QJsonChannelMessage request = QJsonChannelMessagePrivate::createBasicRequest(method, params);
     request.d->type = QJsonChannelMessage::Request;
-    QJsonChannelMessagePrivate::uniqueRequestCounter++;
-    request.d->object->insert(QLatin1String("id"), QJsonChannelMessagePrivate::uniqueRequestCounter);
+    request.d->id = QJsonValue(QJsonChannelMessagePrivate::nextRequestId());
+    request.d->mutableEnvelope()->insert(QLatin1String("id"), request.d->id);
     return request;
 }
 
@@ -207,8 +983,8 @@ QJsonChannelMessage QJsonChannelMessage::createRequest(const QString &method,
     QJsonChannelMessage request =
         QJsonChannelMessagePrivate::createBasicRequest(method, namedParameters);
     request.d->type = QJsonChannelMessage::Request;
-    QJsonChannelMessagePrivate::uniqueRequestCounter++;
-    request.d->object->insert(QLatin1String("id"), QJsonChannelMessagePrivate::uniqueRequestCounter);
+    request.d->id = QJsonValue(QJsonChannelMessagePrivate::nextRequestId());
+    request.d->mutableEnvelope()->insert(QLatin1String("id"), request.d->id);
     return request;
 }
 
@@ -238,57 +1014,144 @@ QJsonChannelMessage QJsonChannelMessage::createNotification(const QString &metho
 QJsonChannelMessage QJsonChannelMessage::createResponse(const QJsonValue &result) const
 {
     QJsonChannelMessage response;
-    if (d->object->contains(QLatin1String("id"))) {
-        QJsonObject *object = response.d->object.data();
-        object->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
-        object->insert(QLatin1String("id"), d->object->value(QLatin1String("id")));
-        object->insert(QLatin1String("result"), result);
+    if (!d->id.isUndefined()) {
+        response.d->composed = true;
+        response.d->id = d->id;
+        response.d->result = result;
         response.d->type = QJsonChannelMessage::Response;
     }
 
     return response;
 }
 
+QJsonChannelMessage QJsonChannelMessage::createSerializedResponse(const QByteArray &serializedResult) const
+{
+    QJsonChannelMessage response = createResponse(QJsonValue());
+    if (response.d->type == QJsonChannelMessage::Response)
+        response.d->resultData = serializedResult;
+
+    return response;
+}
+
+QJsonChannelMessage QJsonChannelMessage::createCborResponse(const QCborValue &result) const
+{
+    QJsonChannelMessage response = createResponse(QJsonValue());
+    if (response.d->type == QJsonChannelMessage::Response)
+        response.d->cborResult = result;
+
+    return response;
+}
+
+// Standard errors with their messages and envelopes serialized once
+class QJsonChannelErrorTemplates
+{
+public:
+    enum { TemplateCount = 8 };
+
+    QJsonChannelErrorTemplates()
+    {
+        add(QJsonChannel::ParseError, "parse error");
+        add(QJsonChannel::InvalidRequest, "invalid request");
+        add(QJsonChannel::MethodNotFound, "method not found");
+        add(QJsonChannel::InvalidParams, "invalid parameters");
+        add(QJsonChannel::InternalError, "internal error");
+        add(QJsonChannel::ServerErrorBase, "server error");
+        add(QJsonChannel::UserError, "user error");
+        add(QJsonChannel::TimeoutError, "request timed out");
+    }
+
+    // TemplateCount for the codes without a template
+    static int index(int code)
+    {
+        switch (code) {
+        case QJsonChannel::ParseError: return 0;
+        case QJsonChannel::InvalidRequest: return 1;
+        case QJsonChannel::MethodNotFound: return 2;
+        case QJsonChannel::InvalidParams: return 3;
+        case QJsonChannel::InternalError: return 4;
+        case QJsonChannel::ServerErrorBase: return 5;
+        case QJsonChannel::UserError: return 6;
+        case QJsonChannel::TimeoutError: return 7;
+        default: return TemplateCount;
+        }
+    }
+
+    QString messages[TemplateCount];
+    QByteArray prefixes[TemplateCount];
+
+private:
+    void add(QJsonChannel::ErrorCode code, const char *message)
+    {
+        const int i = index(code);
+        messages[i] = QLatin1String(message);
+        prefixes[i] = "{\"error\":{\"code\":";
+        writeNumber(prefixes[i], code);
+        prefixes[i] += ",\"message\":";
+        writeString(prefixes[i], messages[i]);
+        prefixes[i] += "},\"id\":";
+    }
+};
+Q_GLOBAL_STATIC(QJsonChannelErrorTemplates, errorTemplates)
+
+QJsonChannelMessage QJsonChannelMessage::createStandardErrorResponse(QJsonChannel::ErrorCode code) const
+{
+    // the templates are gone while the statics are destroyed
+    const int i = QJsonChannelErrorTemplates::index(code);
+    QJsonChannelErrorTemplates *templates = errorTemplates();
+    if (i == QJsonChannelErrorTemplates::TemplateCount || !templates)
+        return createErrorResponse(code);
+
+    QJsonChannelMessage response;
+    response.d->type = QJsonChannelMessage::Error;
+    response.d->composed = true;
+    response.d->id = d->id.isUndefined() ? QJsonValue(0) : d->id;
+    response.d->errorCode = code;
+    response.d->errorMessage = templates->messages[i];
+    response.d->errorPrefix = &templates->prefixes[i];
+    return response;
+}
+
 QJsonChannelMessage QJsonChannelMessage::createErrorResponse(QJsonChannel::ErrorCode code,
                                                      const QString &message,
                                                      const QJsonValue &data) const
 {
     QJsonChannelMessage response;
-    QJsonObject error;
-    error.insert(QLatin1String("code"), code);
-    if (!message.isEmpty())
-        error.insert(QLatin1String("message"), message);
-    if (!data.isUndefined())
-        error.insert(QLatin1String("data"), data);
-
     response.d->type = QJsonChannelMessage::Error;
-    QJsonObject *object = response.d->object.data();
-    object->insert(QLatin1String("jsonrpc"), QLatin1String("2.0"));
-    if (d->object->contains(QLatin1String("id")))
-        object->insert(QLatin1String("id"), d->object->value(QLatin1String("id")));
-    else
-        object->insert(QLatin1String("id"), 0);
-    object->insert(QLatin1String("error"), error);
+    response.d->composed = true;
+    response.d->id = d->id.isUndefined() ? QJsonValue(0) : d->id;
+    response.d->errorCode = code;
+    response.d->errorMessage = message;
+    response.d->errorData = data;
     return response;
 }
 
-int QJsonChannelMessage::id() const
+qint64 QJsonChannelMessage::id() const
 {
-    if (d->type == QJsonChannelMessage::Notification || !d->object)
+    if (d->type == QJsonChannelMessage::Notification)
         return -1;
 
-    const QJsonValue &value = d->object->value(QLatin1String("id"));
+    const QJsonValue &value = d->id;
     if (value.isString())
-        return value.toString().toInt();
-    return value.toInt();
+        return value.toString().toLongLong();
+    return qint64(value.toDouble());
+}
+
+QJsonValue QJsonChannelMessage::idValue() const
+{
+    return d->id;
 }
 
 QString QJsonChannelMessage::method() const
 {
-    if (d->type == QJsonChannelMessage::Response || !d->object)
+    if (d->type == QJsonChannelMessage::Response)
         return QString();
 
-    return d->object->value(QLatin1String("method")).toString();
+    return QString::fromUtf8(d->methodPath);
+}
+
+const QByteArray &QJsonChannelMessage::methodPath() const
+{
+    return d->methodPath;
 }
 
 QString QJsonChannelMessage::serviceName () const
@@ -300,27 +1163,41 @@ QJsonValue QJsonChannelMessage::params() const
 {
     if (d->type == QJsonChannelMessage::Response || d->type == QJsonChannelMessage::Error)
         return QJsonValue(QJsonValue::Undefined);
-    if (!d->object)
-        return QJsonValue(QJsonValue::Undefined);
 
-    return d->object->value(QLatin1String("params"));
+    return d->lazyParams();
 }
 
 QJsonValue QJsonChannelMessage::result() const
 {
-    if (d->type != QJsonChannelMessage::Response || !d->object)
+    if (d->type != QJsonChannelMessage::Response)
         return QJsonValue(QJsonValue::Undefined);
+    if (d->composed)
+        return d->composedResult();
+
+    return d->envelope().value(QLatin1String("result"));
+}
+
+QByteArray QJsonChannelMessage::resultJson() const
+{
+    if (d->type != QJsonChannelMessage::Response)
+        return QByteArray();
+    if (d->composed && !d->resultData.isNull())
+        return d->resultData;
 
-    return d->object->value(QLatin1String("result"));
+    QByteArray buffer;
+    writeValue(buffer, result());
+    return buffer;
 }
 
 int QJsonChannelMessage::errorCode() const
 {
-    if (d->type != QJsonChannelMessage::Error || !d->object)
+    if (d->type != QJsonChannelMessage::Error)
         return 0;
+    if (d->composed)
+        return d->errorCode;
 
     QJsonObject error =
-        d->object->value(QLatin1String("error")).toObject();
+        d->envelope().value(QLatin1String("error")).toObject();
     const QJsonValue &value = error.value(QLatin1String("code"));
     if (value.isString())
         return value.toString().toInt();
@@ -329,21 +1206,25 @@ int QJsonChannelMessage::errorCode() const
 
 QString QJsonChannelMessage::errorMessage() const
 {
-    if (d->type != QJsonChannelMessage::Error || !d->object)
+    if (d->type != QJsonChannelMessage::Error)
         return QString();
+    if (d->composed)
+        return d->errorMessage;
 
     QJsonObject error =
-        d->object->value(QLatin1String("error")).toObject();
+        d->envelope().value(QLatin1String("error")).toObject();
     return error.value(QLatin1String("message")).toString();
 }
 
 QJsonValue QJsonChannelMessage::errorData() const
 {
-    if (d->type != QJsonChannelMessage::Error || !d->object)
+    if (d->type != QJsonChannelMessage::Error)
         return QJsonValue(QJsonValue::Undefined);
+    if (d->composed)
+        return d->errorData;
 
     QJsonObject error =
-        d->object->value(QLatin1String("error")).toObject();
+        d->envelope().value(QLatin1String("error")).toObject();
     return error.value(QLatin1String("data"));
 }
 
@@ -367,7 +1248,7 @@ QDebug operator<<(QDebug dbg, const QJsonChannelMessage &msg)
 {
     dbg.nospace() << "QJsonChannelMessage(type=" << msg.type();
     if (msg.type() != QJsonChannelMessage::Notification) {
-        dbg.nospace() << ", id=" << msg.id();
+        dbg.nospace() << ", id=" << msg.idValue();
     }
 
     if (msg.type() == QJsonChannelMessage::Request ||
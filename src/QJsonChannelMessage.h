@@ -6,6 +6,10 @@
 #include <QJsonValue>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QJsonDocument>
+#include <QCborValue>
+
+#include <functional>
 
 #include "QJsonChannelGlobal.h"
 
@@ -46,7 +50,8 @@ public:
         };
 
     /**
-     * @brief Create a Request for a positional method call
+     * @brief Create a Request for a positional method call. The generated ids are unique up to 2^53 requests,
+     * the largest integer exact in a JSON number, then the sequence starts again from 1.
      * 
      * @param method Method name
      * @param params Arguments values array 
@@ -103,6 +108,22 @@ public:
      */
     QJsonChannelMessage createResponse (const QJsonValue& result) const;
 
+    /**
+     * @brief Create a Response object with already serialized result, toJson and writeJson write the result data as is
+     * 
+     * @param serializedResult Compact JSON of the call result
+     * @return QJsonChannelMessage 
+     */
+    QJsonChannelMessage createSerializedResponse (const QByteArray& serializedResult) const;
+
+    /**
+     * @brief Create a Response object with a CBOR result, byte strings are written as is by toCbor and as base64url strings by toJson
+     * 
+     * @param result Value of the call result
+     * @return QJsonChannelMessage 
+     */
+    QJsonChannelMessage createCborResponse (const QCborValue& result) const;
+
     /**
      * @brief Create a Error Response object
      * 
@@ -113,6 +134,15 @@ public:
      */
     QJsonChannelMessage createErrorResponse (QJsonChannel::ErrorCode code, const QString& message = QString (), const QJsonValue& data = QJsonValue ()) const;
 
+    /**
+     * @brief Create a Error Response object with the standard message of the code ("parse error", "method not found"...).
+     * The error is serialized once per process, only the id is written per response.
+     * 
+     * @param code Error code
+     * @return QJsonChannelMessage 
+     */
+    QJsonChannelMessage createStandardErrorResponse (QJsonChannel::ErrorCode code) const;
+
     /**
      * @brief Returns message type
      * 
@@ -129,11 +159,18 @@ public:
     bool                      isValid () const;
 
     /**
-     * @brief Returns message Id
+     * @brief Returns message Id, a string Id is converted to a number (see idValue)
+     * 
+     * @return qint64 message Id, -1 for notifications
+     */
+    qint64                    id () const;
+
+    /**
+     * @brief Returns message Id exactly as it's sent: a number, a string or null
      * 
-     * @return int message Id
+     * @return QJsonValue message Id, undefined for notifications
      */
-    int                       id () const;
+    QJsonValue                idValue () const;
 
     // request
     /**
@@ -148,12 +185,30 @@ public:
      * @return QString 
      */
     QString    method () const;
+    /**
+     * @brief Returns requested method path ("service.method") as UTF-8 data (of Request message)
+     * 
+     * @return const QByteArray& 
+     */
+    const QByteArray& methodPath () const;
     /**
      * @brief Returns the Request params (of Request message)
      * 
      * @return QJsonValue 
      */
     QJsonValue params () const;
+    /**
+     * @brief Returns the Request params of a message decoded from CBOR with byte strings as is (of Request message)
+     * 
+     * @return QCborValue Undefined if the message isn't decoded from CBOR
+     */
+    QCborValue cborParams () const;
+    /**
+     * @brief Returns true if the message was decoded from CBOR
+     * 
+     * @return bool 
+     */
+    bool       isCbor () const;
 
     // response
     /**
@@ -162,6 +217,12 @@ public:
      * @return QJsonValue 
      */
     QJsonValue result () const;
+    /**
+     * @brief Returns Response value serialized compactly (of response message)
+     * 
+     * @return QByteArray 
+     */
+    QByteArray resultJson () const;
 
     // error
     /**
@@ -201,17 +262,40 @@ public:
     /**
      * @brief Converts the message to string data
      * 
+     * @param format Output format, QJsonDocument::Compact is written without building a JSON document
      * @return QByteArray 
      */
-    QByteArray                 toJson () const;
+    QByteArray                 toJson (QJsonDocument::JsonFormat format = QJsonDocument::Indented) const;
+    /**
+     * @brief Appends the message as compact string data to the buffer. 
+     * A buffer with reserved capacity can be reused for many messages without reallocations.
+     * 
+     * @param buffer Output buffer
+     */
+    void                       writeJson (QByteArray& buffer) const;
     /**
-     * @brief Convert a string data to a JSON-RPC message
+     * @brief Convert a string data to a JSON-RPC message. The envelope is scanned in a single pass without building a JSON document,
+     * the params are kept as a slice of the data and parsed on the first access.
      * 
-     * @param data String data
+     * @param data String data, the message keeps a reference to it
      * @return QJsonChannelMessage 
      */
     static QJsonChannelMessage fromJson (const QByteArray& data);
 
+    /**
+     * @brief Converts the message to CBOR, the message decoded from CBOR is returned as is
+     * 
+     * @return QCborValue 
+     */
+    QCborValue                 toCbor () const;
+    /**
+     * @brief Convert a CBOR value to a JSON-RPC message
+     * 
+     * @param message CBOR map of the message
+     * @return QJsonChannelMessage 
+     */
+    static QJsonChannelMessage fromCbor (const QCborValue& message);
+
     bool        operator== (const QJsonChannelMessage& message) const;
     inline bool operator!= (const QJsonChannelMessage& message) const {
         return !(operator== (message));
@@ -225,3 +309,9 @@ private:
 QJSONCHANNELCORE_EXPORT QDebug operator<< (QDebug, const QJsonChannelMessage&);
 Q_DECLARE_METATYPE (QJsonChannelMessage)
 Q_DECLARE_SHARED (QJsonChannelMessage)
+
+/**
+ * @brief Receives the response of an asynchronously processed message
+ * 
+ */
+typedef std::function<void (const QJsonChannelMessage&)> QJsonChannelCompletion;
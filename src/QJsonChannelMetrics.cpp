@@ -0,0 +1,269 @@
+#include <QAtomicInt>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <algorithm>
+
+#include "QJsonChannelMetrics.h"
+
+namespace {
+
+const int bucketCount = 20; // bucket i is bounded by 2^i microseconds, the last one is unbounded
+
+QAtomicInt metricsEnabled;
+
+struct QJsonChannelHistogramCounters {
+    void add (qint64 nanoseconds) {
+        const quint64 micros = (quint64 (qMax (nanoseconds, qint64 (0))) + 999) / 1000;
+        const int     bucket = micros <= 1 ? 0 : 64 - qCountLeadingZeroBits (micros - 1);
+        ++_buckets[qMin (bucket, bucketCount - 1)];
+        ++_count;
+        _sum += nanoseconds;
+    }
+
+    void merge (const QJsonChannelHistogramCounters& other) {
+        for (int i = 0; i < bucketCount; ++i)
+            _buckets[i] += other._buckets[i];
+        _count += other._count;
+        _sum += other._sum;
+    }
+
+    quint64 _buckets[bucketCount] = {};
+    quint64 _count                = 0;
+    qint64  _sum                  = 0; // nanoseconds
+};
+
+struct QJsonChannelMethodCounters {
+    quint64 _calls    = 0;
+    quint64 _failures = 0;
+};
+
+// Counters of a thread. Its mutex is taken by the owner thread and by the snapshots only, so it's not contended.
+struct QJsonChannelMetricsShard {
+    void merge (const QJsonChannelMetricsShard& other) {
+        for (auto it = other._methods.constBegin (); it != other._methods.constEnd (); ++it) {
+            QJsonChannelMethodCounters& counters = _methods[it.key ()];
+            counters._calls += it.value ()._calls;
+            counters._failures += it.value ()._failures;
+        }
+        for (auto it = other._errors.constBegin (); it != other._errors.constEnd (); ++it)
+            _errors[it.key ()] += it.value ();
+        for (int stage = 0; stage < QJsonChannelMetrics::StageCount; ++stage)
+            _latency[stage].merge (other._latency[stage]);
+    }
+
+    void clear () {
+        _methods.clear ();
+        _errors.clear ();
+        for (QJsonChannelHistogramCounters& histogram : _latency)
+            histogram = QJsonChannelHistogramCounters ();
+    }
+
+    QMutex                                        _mutex;
+    QHash<QByteArray, QJsonChannelMethodCounters> _methods;
+    QHash<int, quint64>                           _errors;
+    QJsonChannelHistogramCounters                 _latency[QJsonChannelMetrics::StageCount];
+};
+
+struct QJsonChannelMetricsRegistry {
+    QMutex                           _mutex;
+    QList<QJsonChannelMetricsShard*> _shards;
+    QJsonChannelMetricsShard         _retired; // counters of the finished threads
+};
+
+Q_GLOBAL_STATIC (QJsonChannelMetricsRegistry, metricsRegistry)
+
+// Owns the shard of a thread, the counters are folded into the registry when the thread finishes
+struct QJsonChannelThreadShard {
+    ~QJsonChannelThreadShard () {
+        if (!_shard)
+            return;
+
+        if (!metricsRegistry.isDestroyed ()) {
+            QJsonChannelMetricsRegistry* registry = metricsRegistry ();
+            QMutexLocker                 lock (&registry->_mutex);
+            registry->_shards.removeOne (_shard);
+            registry->_retired.merge (*_shard);
+        }
+        delete _shard;
+    }
+
+    QJsonChannelMetricsShard* shard () {
+        if (!_shard) {
+            _shard                                = new QJsonChannelMetricsShard;
+            QJsonChannelMetricsRegistry* registry = metricsRegistry ();
+            QMutexLocker                 lock (&registry->_mutex);
+            registry->_shards.append (_shard);
+        }
+        return _shard;
+    }
+
+    QJsonChannelMetricsShard* _shard = nullptr;
+};
+
+thread_local QJsonChannelThreadShard threadShard;
+
+QByteArray prometheusLabel (const QByteArray& value) {
+    QByteArray escaped;
+    escaped.reserve (value.size ());
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            escaped += '\\';
+        if (c == '\n') {
+            escaped += "\\n";
+            continue;
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// {service="...",method="..."} labels of a method path
+QByteArray methodLabels (const QByteArray& methodPath) {
+    const int dot = methodPath.lastIndexOf ('.');
+    return "{service=\"" + prometheusLabel (methodPath.left (qMax (dot, 0))) + "\",method=\"" + prometheusLabel (methodPath.mid (dot + 1)) + "\"}";
+}
+
+} // namespace
+
+QJsonChannelMetrics::StageTimer::StageTimer (Stage stage) : _stage (stage) {
+    if (isEnabled ())
+        _timer.start ();
+}
+
+QJsonChannelMetrics::StageTimer::~StageTimer () {
+    stop ();
+}
+
+void QJsonChannelMetrics::StageTimer::stop () {
+    if (!_timer.isValid ())
+        return;
+    recordLatency (_stage, _timer.nsecsElapsed ());
+    _timer.invalidate ();
+}
+
+void QJsonChannelMetrics::setEnabled (bool enabled) {
+    metricsEnabled.storeRelease (enabled ? 1 : 0);
+}
+
+bool QJsonChannelMetrics::isEnabled () {
+    return metricsEnabled.loadAcquire () != 0;
+}
+
+void QJsonChannelMetrics::reset () {
+    QJsonChannelMetricsRegistry* registry = metricsRegistry ();
+    QMutexLocker                 lock (&registry->_mutex);
+    registry->_retired.clear ();
+    for (QJsonChannelMetricsShard* shard : registry->_shards) {
+        QMutexLocker shardLock (&shard->_mutex);
+        shard->clear ();
+    }
+}
+
+QJsonChannelMetrics::Snapshot QJsonChannelMetrics::snapshot () {
+    QJsonChannelMetricsShard     merged;
+    QJsonChannelMetricsRegistry* registry = metricsRegistry ();
+    {
+        QMutexLocker lock (&registry->_mutex);
+        merged.merge (registry->_retired);
+        for (QJsonChannelMetricsShard* shard : registry->_shards) {
+            QMutexLocker shardLock (&shard->_mutex);
+            merged.merge (*shard);
+        }
+    }
+
+    Snapshot snapshot;
+    for (auto it = merged._methods.constBegin (); it != merged._methods.constEnd (); ++it) {
+        snapshot.calls.insert (it.key (), it.value ()._calls);
+        if (it.value ()._failures)
+            snapshot.failures.insert (it.key (), it.value ()._failures);
+    }
+    for (auto it = merged._errors.constBegin (); it != merged._errors.constEnd (); ++it)
+        snapshot.errors.insert (it.key (), it.value ());
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const QJsonChannelHistogramCounters& counters  = merged._latency[stage];
+        Histogram&                           histogram = snapshot.latency[stage];
+        histogram.buckets.resize (bucketCount);
+        std::copy (counters._buckets, counters._buckets + bucketCount, histogram.buckets.begin ());
+        histogram.count = counters._count;
+        histogram.sum   = counters._sum / 1e9;
+    }
+    return snapshot;
+}
+
+QByteArray QJsonChannelMetrics::toPrometheus () {
+    static const char* const stageNames[StageCount] = {"parse", "dispatch", "serialize", "lock_wait"};
+
+    const Snapshot        metrics = snapshot ();
+    const QVector<double> bounds  = bucketBounds ();
+    QByteArray            text;
+    QList<QByteArray>     methods = metrics.calls.keys ();
+    std::sort (methods.begin (), methods.end ());
+
+    text += "# HELP qjsonchannel_calls_total Dispatched JSON-RPC requests and notifications.\n";
+    text += "# TYPE qjsonchannel_calls_total counter\n";
+    for (const QByteArray& method : methods)
+        text += "qjsonchannel_calls_total" + methodLabels (method) + ' ' + QByteArray::number (metrics.calls.value (method)) + '\n';
+
+    text += "# HELP qjsonchannel_call_errors_total Error responses of the dispatched requests.\n";
+    text += "# TYPE qjsonchannel_call_errors_total counter\n";
+    for (const QByteArray& method : methods)
+        text += "qjsonchannel_call_errors_total" + methodLabels (method) + ' ' + QByteArray::number (metrics.failures.value (method)) + '\n';
+
+    text += "# HELP qjsonchannel_errors_total Error responses by JSON-RPC error code.\n";
+    text += "# TYPE qjsonchannel_errors_total counter\n";
+    for (auto it = metrics.errors.constBegin (); it != metrics.errors.constEnd (); ++it)
+        text += "qjsonchannel_errors_total{code=\"" + QByteArray::number (it.key ()) + "\"} " + QByteArray::number (it.value ()) + '\n';
+
+    text += "# HELP qjsonchannel_stage_seconds Latency of the message processing stages.\n";
+    text += "# TYPE qjsonchannel_stage_seconds histogram\n";
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const Histogram& histogram  = metrics.latency[stage];
+        const QByteArray label      = QByteArray ("stage=\"") + stageNames[stage] + '"';
+        quint64          cumulative = 0;
+        for (int i = 0; i < histogram.buckets.size (); ++i) {
+            cumulative += histogram.buckets.at (i);
+            const QByteArray le = i < bounds.size () ? QByteArray::number (bounds.at (i), 'g', 6) : QByteArray ("+Inf");
+            text += "qjsonchannel_stage_seconds_bucket{" + label + ",le=\"" + le + "\"} " + QByteArray::number (cumulative) + '\n';
+        }
+        text += "qjsonchannel_stage_seconds_sum{" + label + "} " + QByteArray::number (histogram.sum, 'g', 9) + '\n';
+        text += "qjsonchannel_stage_seconds_count{" + label + "} " + QByteArray::number (histogram.count) + '\n';
+    }
+    return text;
+}
+
+QVector<double> QJsonChannelMetrics::bucketBounds () {
+    QVector<double> bounds;
+    bounds.reserve (bucketCount - 1);
+    for (int i = 0; i < bucketCount - 1; ++i)
+        bounds.append ((quint64 (1) << i) / 1e6);
+    return bounds;
+}
+
+void QJsonChannelMetrics::recordCall (const QByteArray& methodPath, const QJsonChannelMessage& response) {
+    if (!isEnabled ())
+        return;
+
+    const bool                failed = response.type () == QJsonChannelMessage::Error;
+    const int                 code   = failed ? response.errorCode () : 0;
+    QJsonChannelMetricsShard* shard  = threadShard.shard ();
+    QMutexLocker              lock (&shard->_mutex);
+    if (!methodPath.isEmpty ()) {
+        QJsonChannelMethodCounters& counters = shard->_methods[methodPath];
+        ++counters._calls;
+        if (failed)
+            ++counters._failures;
+    }
+    if (failed)
+        ++shard->_errors[code];
+}
+
+void QJsonChannelMetrics::recordLatency (Stage stage, qint64 nanoseconds) {
+    if (!isEnabled ())
+        return;
+
+    QJsonChannelMetricsShard* shard = threadShard.shard ();
+    QMutexLocker              lock (&shard->_mutex);
+    shard->_latency[stage].add (nanoseconds);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+#include "QJsonChannelMessage.h"
+
+/**
+ * @brief Process wide dispatch metrics: calls per service method, error responses per error code and latency histograms
+ * of the processing stages. The counters are kept per thread, so recording takes no shared lock.
+ * Metrics are disabled by default, a disabled recording costs a flag check.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelMetrics {
+public:
+    /**
+     * @brief Measured stage of the message processing
+     *
+     */
+    enum Stage {
+        //! Decoding of a message or a batch
+        Parse,
+        //! Routing and invocation of a message, including the service lock wait
+        Dispatch,
+        //! Encoding of a response or a batch response
+        Serialize,
+        //! Waiting for the lock of a service object which is not thread safe
+        LockWait,
+        StageCount
+    };
+
+    /**
+     * @brief Latency histogram of a stage
+     *
+     */
+    struct Histogram {
+        QVector<quint64> buckets; //!< Number of samples per bucket (not cumulative), see bucketBounds
+        quint64          count = 0;
+        double           sum   = 0; //!< Sum of the samples in seconds
+    };
+
+    /**
+     * @brief Counters merged from all the threads
+     *
+     */
+    struct Snapshot {
+        QHash<QByteArray, quint64> calls;    //!< "service.method" -> number of dispatched requests and notifications
+        QHash<QByteArray, quint64> failures; //!< "service.method" -> number of error responses
+        QMap<int, quint64>         errors;   //!< Error code -> number of error responses, including the messages which were not routed
+        Histogram                  latency[StageCount];
+    };
+
+    /**
+     * @brief Records the execution time of a stage when the timer is stopped or destroyed, does nothing if the metrics are disabled
+     *
+     */
+    class StageTimer {
+    public:
+        explicit StageTimer (Stage stage);
+        ~StageTimer ();
+
+        /**
+         * @brief Records the elapsed time, the timer records nothing after it
+         *
+         */
+        void stop ();
+
+    private:
+        Q_DISABLE_COPY (StageTimer)
+
+        Stage         _stage;
+        QElapsedTimer _timer;
+    };
+
+    /**
+     * @brief Enables or disables the recording
+     *
+     * @param enabled Record the metrics
+     */
+    static void setEnabled (bool enabled);
+
+    /**
+     * @brief Returns true if the metrics are recorded
+     *
+     * @return true
+     * @return false
+     */
+    static bool isEnabled ();
+
+    /**
+     * @brief Clears all the counters
+     *
+     */
+    static void reset ();
+
+    /**
+     * @brief Merges the counters of all the threads
+     *
+     * @return Snapshot
+     */
+    static Snapshot snapshot ();
+
+    /**
+     * @brief Returns the counters in the Prometheus text exposition format
+     *
+     * @return QByteArray
+     */
+    static QByteArray toPrometheus ();
+
+    /**
+     * @brief Returns the upper bounds of the histogram buckets in seconds, the last bucket is unbounded
+     *
+     * @return QVector<double>
+     */
+    static QVector<double> bucketBounds ();
+
+    /**
+     * @brief Counts a processed message
+     *
+     * @param methodPath "service.method" of a routed message, empty if the message was not routed to a method
+     * @param response Response of the message, an error response is counted by its error code
+     */
+    static void recordCall (const QByteArray& methodPath, const QJsonChannelMessage& response);
+
+    /**
+     * @brief Adds a sample to the stage histogram
+     *
+     * @param stage Measured stage
+     * @param nanoseconds Execution time
+     */
+    static void recordLatency (Stage stage, qint64 nanoseconds);
+};
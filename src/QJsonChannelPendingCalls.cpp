@@ -0,0 +1,221 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFutureInterface>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QVector>
+
+#include "QJsonChannelPendingCalls.h"
+
+namespace {
+
+const int shardCount = 16; // power of two
+const int wheelSize  = 1024;
+
+// Id of a call, string ids are compared exactly
+struct QJsonChannelCallKey {
+    bool    _isString = false;
+    double  _number   = 0;
+    QString _string;
+
+    bool operator== (const QJsonChannelCallKey& other) const {
+        return _isString == other._isString && (_isString ? _string == other._string : _number == other._number);
+    }
+};
+
+uint qHash (const QJsonChannelCallKey& key, uint seed = 0) {
+    return key._isString ? ::qHash (key._string, seed) : ::qHash (key._number, seed);
+}
+
+bool makeKey (const QJsonValue& id, QJsonChannelCallKey* key) {
+    if (id.isString ()) {
+        key->_isString = true;
+        key->_string   = id.toString ();
+        return true;
+    }
+    if (id.isDouble ()) {
+        key->_number = id.toDouble ();
+        return true;
+    }
+    return false;
+}
+
+struct QJsonChannelPendingCall {
+    QJsonChannelMessage    _request;
+    QJsonChannelCompletion _completion;
+    quint64                _sequence = 0;
+};
+
+// Timeout of a call, it's stale if the call was completed or replaced
+struct QJsonChannelTimerEntry {
+    QJsonChannelCallKey _key;
+    quint64             _sequence = 0;
+    qint64              _tick     = 0;
+};
+
+struct QJsonChannelPendingShard {
+    QMutex                                               _mutex;
+    QHash<QJsonChannelCallKey, QJsonChannelPendingCall> _calls;
+    QVector<QJsonChannelTimerEntry>                      _wheel[wheelSize];
+    qint64                                               _tick     = 0; // the last expired tick
+    quint64                                              _sequence = 0;
+};
+
+} // namespace
+
+class QJsonChannelPendingCallsPrivate {
+public:
+    QJsonChannelPendingShard& shard (const QJsonChannelCallKey& key) {
+        return _shards[qHash (key) & (shardCount - 1)];
+    }
+
+    int                      _timeout;
+    int                      _resolution;
+    QElapsedTimer            _clock;
+    QAtomicInt               _size;
+    QJsonChannelPendingShard _shards[shardCount];
+    QScopedPointer<QTimer>   _timer;
+};
+
+QJsonChannelPendingCalls::QJsonChannelPendingCalls (int timeout, int resolution) : d (new QJsonChannelPendingCallsPrivate) {
+    d->_timeout    = timeout;
+    d->_resolution = qMax (1, resolution);
+    d->_clock.start ();
+
+    // one timer for all the calls
+    if (QCoreApplication::instance ()) {
+        d->_timer.reset (new QTimer);
+        d->_timer->setInterval (d->_resolution);
+        QObject::connect (d->_timer.data (), &QTimer::timeout, [this] () { expire (); });
+        d->_timer->start ();
+    }
+}
+
+QJsonChannelPendingCalls::~QJsonChannelPendingCalls () {
+    d->_timer.reset ();
+
+    QList<QJsonChannelPendingCall> canceled;
+    for (QJsonChannelPendingShard& shard : d->_shards) {
+        QMutexLocker lock (&shard._mutex);
+        canceled.append (shard._calls.values ());
+        shard._calls.clear ();
+    }
+
+    for (const QJsonChannelPendingCall& call : canceled)
+        call._completion (call._request.createErrorResponse (QJsonChannel::InternalError, "pending call canceled"));
+}
+
+bool QJsonChannelPendingCalls::add (const QJsonChannelMessage& request, const QJsonChannelCompletion& completion, int timeout) {
+    QJsonChannelCallKey key;
+    if (request.type () != QJsonChannelMessage::Request || !makeKey (request.idValue (), &key))
+        return false;
+
+    if (timeout < 0)
+        timeout = d->_timeout;
+    const qint64 tick = (d->_clock.elapsed () + timeout + d->_resolution - 1) / d->_resolution;
+
+    QJsonChannelPendingShard& shard = d->shard (key);
+    QMutexLocker              lock (&shard._mutex);
+    if (shard._calls.contains (key)) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "call with id" << request.idValue () << "is already pending";
+        return false;
+    }
+
+    QJsonChannelPendingCall& call = shard._calls[key];
+    call._request                 = request;
+    call._completion              = completion;
+    call._sequence                = ++shard._sequence;
+
+    // a deadline behind the wheel cursor is expired by the next tick
+    QJsonChannelTimerEntry entry;
+    entry._key      = key;
+    entry._sequence = call._sequence;
+    entry._tick     = tick;
+    shard._wheel[qMax (tick, shard._tick + 1) % wheelSize].append (entry);
+
+    d->_size.ref ();
+    return true;
+}
+
+QFuture<QJsonChannelMessage> QJsonChannelPendingCalls::add (const QJsonChannelMessage& request, int timeout) {
+    QFutureInterface<QJsonChannelMessage> promise;
+    promise.reportStarted ();
+    QFuture<QJsonChannelMessage> future = promise.future ();
+
+    auto completion = [promise] (const QJsonChannelMessage& response) mutable {
+        promise.reportResult (response);
+        promise.reportFinished ();
+    };
+    if (!add (request, completion, timeout))
+        completion (request.createErrorResponse (QJsonChannel::InvalidRequest, "request can't be pending"));
+    return future;
+}
+
+bool QJsonChannelPendingCalls::complete (const QJsonChannelMessage& response) {
+    QJsonChannelCallKey key;
+    if (response.type () != QJsonChannelMessage::Response && response.type () != QJsonChannelMessage::Error)
+        return false;
+    if (!makeKey (response.idValue (), &key))
+        return false;
+
+    // the timer entry is left in the wheel, it's dropped as stale when its tick comes
+    QJsonChannelPendingCall   call;
+    QJsonChannelPendingShard& shard = d->shard (key);
+    {
+        QMutexLocker lock (&shard._mutex);
+        auto         it = shard._calls.find (key);
+        if (it == shard._calls.end ())
+            return false;
+        call = it.value ();
+        shard._calls.erase (it);
+    }
+
+    d->_size.deref ();
+    call._completion (response);
+    return true;
+}
+
+int QJsonChannelPendingCalls::expire () {
+    const qint64                   now = d->_clock.elapsed () / d->_resolution;
+    QList<QJsonChannelPendingCall> expired;
+
+    for (QJsonChannelPendingShard& shard : d->_shards) {
+        QMutexLocker lock (&shard._mutex);
+        if (now <= shard._tick)
+            continue;
+
+        // after a pause longer than the wheel every bucket is visited once
+        for (qint64 tick = qMax (shard._tick + 1, now - wheelSize + 1); tick <= now; ++tick) {
+            QVector<QJsonChannelTimerEntry>& bucket = shard._wheel[tick % wheelSize];
+            for (int i = 0; i < bucket.size ();) {
+                const QJsonChannelTimerEntry& entry = bucket.at (i);
+                if (entry._tick > now) {
+                    // the next round of the wheel
+                    ++i;
+                    continue;
+                }
+
+                auto it = shard._calls.find (entry._key);
+                if (it != shard._calls.end () && it.value ()._sequence == entry._sequence) {
+                    expired.append (it.value ());
+                    shard._calls.erase (it);
+                }
+                bucket[i] = bucket.last ();
+                bucket.removeLast ();
+            }
+        }
+        shard._tick = now;
+    }
+
+    for (const QJsonChannelPendingCall& call : expired) {
+        d->_size.deref ();
+        call._completion (call._request.createErrorResponse (QJsonChannel::TimeoutError, "request timed out"));
+    }
+    return expired.size ();
+}
+
+int QJsonChannelPendingCalls::size () const {
+    return d->_size.loadAcquire ();
+}
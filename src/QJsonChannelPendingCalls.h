@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QScopedPointer>
+#include <QFuture>
+
+#include "QJsonChannelMessage.h"
+
+class QJsonChannelPendingCallsPrivate;
+
+/**
+ * @brief Client side table of the requests waiting for responses. Responses and errors are matched to the requests by id,
+ * the requests without a response are completed with QJsonChannel::TimeoutError.
+ * The table is sharded by id and the timeouts are kept in timer wheels, so a call costs no timer.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelPendingCalls {
+public:
+    /**
+     * @brief Construct a new QJsonChannelPendingCalls object. The expiration timer runs in the thread of the construction
+     * if it has an event loop, otherwise expire should be called periodically.
+     *
+     * @param timeout Default timeout of a call in milliseconds
+     * @param resolution Timeout precision in milliseconds
+     */
+    explicit QJsonChannelPendingCalls (int timeout = 30000, int resolution = 100);
+
+    /**
+     * @brief Destroys the table, the pending calls are completed with QJsonChannel::InternalError
+     *
+     */
+    ~QJsonChannelPendingCalls ();
+
+    /**
+     * @brief Registers a sent request
+     *
+     * @param request JSON-RPC request message
+     * @param completion Receives the response, the error or the timeout error
+     * @param timeout Timeout of the call in milliseconds, the default timeout if it's negative
+     * @return true The call is pending
+     * @return false The message is not a request or a call with its id is already pending
+     */
+    bool add (const QJsonChannelMessage& request, const QJsonChannelCompletion& completion, int timeout = -1);
+
+    /**
+     * @brief Registers a sent request
+     *
+     * @param request JSON-RPC request message
+     * @param timeout Timeout of the call in milliseconds, the default timeout if it's negative
+     * @return QFuture<QJsonChannelMessage> The response, the error or the timeout error
+     */
+    QFuture<QJsonChannelMessage> add (const QJsonChannelMessage& request, int timeout = -1);
+
+    /**
+     * @brief Completes the pending call with a received message
+     *
+     * @param response JSON-RPC response or error message
+     * @return true The call was completed
+     * @return false No call with the message id is pending
+     */
+    bool complete (const QJsonChannelMessage& response);
+
+    /**
+     * @brief Completes the calls whose timeout is over with QJsonChannel::TimeoutError
+     *
+     * @return int Number of the expired calls
+     */
+    int expire ();
+
+    /**
+     * @brief Returns the number of pending calls
+     *
+     * @return int
+     */
+    int size () const;
+
+private:
+    Q_DISABLE_COPY (QJsonChannelPendingCalls)
+
+    QScopedPointer<QJsonChannelPendingCallsPrivate> d;
+};
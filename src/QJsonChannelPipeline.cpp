@@ -0,0 +1,373 @@
+#include <QFile>
+#include <QIODevice>
+#include <QMap>
+#include <QMetaObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPointer>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QSocketNotifier>
+#include <QThreadPool>
+#include <QtEndian>
+
+#include <cstdio>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+#include "QJsonChannelCodec.h"
+#include "QJsonChannelPipeline.h"
+#include "QJsonChannelServiceRepository.h"
+
+namespace {
+
+const int readChunkSize = 64 * 1024;
+
+class QJsonChannelPipelineRunnable : public QRunnable {
+public:
+    explicit QJsonChannelPipelineRunnable (const std::function<void ()>& function) : _function (function) {
+    }
+
+    void run () override {
+        _function ();
+    }
+
+private:
+    std::function<void ()> _function;
+};
+
+// Shared with the dispatched frames, the context is gone when the pipeline is destroyed
+struct QJsonChannelPipelineState {
+    QMutex   _mutex;
+    QObject* _context = nullptr;
+};
+
+} // namespace
+
+class QJsonChannelPipelinePrivate {
+public:
+    QJsonChannelPipelinePrivate () : _state (new QJsonChannelPipelineState) {
+        _state->_context = new QObject;
+    }
+    ~QJsonChannelPipelinePrivate () {
+        // the queued completions are discarded with the context
+        QMutexLocker lock (&_state->_mutex);
+        delete _state->_context;
+        _state->_context = nullptr;
+    }
+
+    int inFlight () const {
+        return int(_nextSequence - _nextOutput);
+    }
+
+    void feed (const QByteArray& data);
+    void extract ();
+    bool nextFrame (QByteArray* frame);
+    bool nextLine (QByteArray* frame);
+    bool nextPrefixed (QByteArray* frame);
+    void reject (const QString& message);
+    void dispatch (const QByteArray& frame);
+    void complete (quint64 sequence, const QByteArray& reply);
+    void deliver ();
+    void write (const QByteArray& payload);
+    void resume ();
+    void readDevice ();
+    void readNotified ();
+
+    const QJsonChannelServiceRepository* _repository   = nullptr;
+    const QJsonChannelCodec*             _codec        = nullptr;
+    QJsonChannelPipeline::Framing        _framing      = QJsonChannelPipeline::NewlineFraming;
+    int                                  _maxInFlight  = 64;
+    int                                  _maxFrameSize = 16 * 1024 * 1024;
+
+    // input: [_offset, _scanned) is scanned without finding a delimiter
+    QByteArray _buffer;
+    int        _offset     = 0;
+    int        _scanned    = 0;
+    bool       _discarding = false; // the rest of an oversized line is skipped
+    qint64     _skip       = 0;     // the rest of an oversized prefixed frame is skipped
+
+    // frames are numbered in the input order, the ordered responses are written in the same order
+    bool                      _ordered      = true;
+    quint64                   _nextSequence = 0;
+    quint64                   _nextOutput   = 0; // the number of written responses
+    QMap<quint64, QByteArray> _completed;
+
+    QSharedPointer<QJsonChannelPipelineState> _state;
+    std::function<void (const QByteArray&)>   _sink;
+    QPointer<QIODevice>                       _input;
+    QPointer<QIODevice>                       _output;
+    QMetaObject::Connection                   _readConnection;
+    QScopedPointer<QSocketNotifier>           _notifier;
+    QScopedPointer<QFile>                     _stdout;
+};
+
+void QJsonChannelPipelinePrivate::feed (const QByteArray& data) {
+    if (_buffer.isEmpty ())
+        _buffer = data;
+    else
+        _buffer += data;
+    extract ();
+}
+
+void QJsonChannelPipelinePrivate::extract () {
+    QByteArray frame;
+    while (inFlight () < _maxInFlight && nextFrame (&frame))
+        dispatch (frame);
+
+    // the consumed input is dropped once it's the larger part of the buffer
+    if (_offset == _buffer.size ()) {
+        _buffer.clear ();
+        _scanned = 0;
+        _offset  = 0;
+    } else if (_offset > readChunkSize && _offset > _buffer.size () / 2) {
+        _buffer.remove (0, _offset);
+        _scanned = qMax (_scanned - _offset, 0);
+        _offset  = 0;
+    }
+
+    // rejected frames may be the next to write
+    deliver ();
+}
+
+bool QJsonChannelPipelinePrivate::nextFrame (QByteArray* frame) {
+    return _framing == QJsonChannelPipeline::NewlineFraming ? nextLine (frame) : nextPrefixed (frame);
+}
+
+bool QJsonChannelPipelinePrivate::nextLine (QByteArray* frame) {
+    forever {
+        const int end = _buffer.indexOf ('\n', _scanned);
+        if (end < 0) {
+            _scanned = _buffer.size ();
+            if (_scanned - _offset > _maxFrameSize) {
+                if (!_discarding)
+                    reject ("frame too large");
+                _discarding = true;
+                _offset     = _scanned;
+            }
+            return false;
+        }
+
+        const int start = _offset;
+        _offset = _scanned = end + 1;
+        if (_discarding) {
+            _discarding = false;
+            continue;
+        }
+
+        int size = end - start;
+        if (size > 0 && _buffer.at (end - 1) == '\r')
+            --size;
+        if (size == 0)
+            continue;
+        if (size > _maxFrameSize) {
+            reject ("frame too large");
+            continue;
+        }
+
+        *frame = _buffer.mid (start, size);
+        return true;
+    }
+}
+
+bool QJsonChannelPipelinePrivate::nextPrefixed (QByteArray* frame) {
+    forever {
+        if (_skip > 0) {
+            const int skipped = int(qMin (_skip, qint64 (_buffer.size () - _offset)));
+            _offset += skipped;
+            _skip -= skipped;
+            if (_skip > 0)
+                return false;
+        }
+
+        if (_buffer.size () - _offset < 4)
+            return false;
+
+        const quint32 size = qFromBigEndian<quint32> (reinterpret_cast<const uchar*> (_buffer.constData () + _offset));
+        if (size > quint32 (_maxFrameSize)) {
+            _offset += 4;
+            _skip = size;
+            reject ("frame too large");
+            continue;
+        }
+        if (quint32 (_buffer.size () - _offset - 4) < size)
+            return false;
+
+        *frame = _buffer.mid (_offset + 4, int(size));
+        _offset += 4 + int(size);
+        return true;
+    }
+}
+
+void QJsonChannelPipelinePrivate::reject (const QString& message) {
+    const QJsonChannelCodec*  codec = _codec ? _codec : QJsonChannelCodec::json ();
+    const QJsonChannelMessage error = QJsonChannelMessage ().createErrorResponse (QJsonChannel::ParseError, message);
+    _completed.insert (_nextSequence++, codec->encode ({error}, false));
+}
+
+void QJsonChannelPipelinePrivate::dispatch (const QByteArray& frame) {
+    const quint64                             sequence   = _nextSequence++;
+    const QJsonChannelServiceRepository*      repository = _repository;
+    const QJsonChannelCodec*                  codec      = _codec;
+    QSharedPointer<QJsonChannelPipelineState> state      = _state;
+    QJsonChannelPipelinePrivate*              pipeline   = this;
+
+    _repository->threadPool ()->start (new QJsonChannelPipelineRunnable ([repository, codec, state, pipeline, sequence, frame] () {
+        const QByteArray reply = repository->processData (frame, codec);
+
+        QMutexLocker lock (&state->_mutex);
+        if (state->_context) {
+            QMetaObject::invokeMethod (
+                state->_context, [pipeline, sequence, reply] () { pipeline->complete (sequence, reply); }, Qt::QueuedConnection);
+        }
+    }));
+}
+
+void QJsonChannelPipelinePrivate::complete (quint64 sequence, const QByteArray& reply) {
+    _completed.insert (sequence, reply);
+    deliver ();
+    extract ();
+    resume ();
+}
+
+void QJsonChannelPipelinePrivate::deliver () {
+    // notifications leave empty replies, they only release their place in the window
+    while (!_completed.isEmpty () && (!_ordered || _completed.firstKey () == _nextOutput)) {
+        const QByteArray reply = _completed.take (_completed.firstKey ());
+        ++_nextOutput;
+        if (!reply.isEmpty ())
+            write (reply);
+    }
+}
+
+void QJsonChannelPipelinePrivate::write (const QByteArray& payload) {
+    QByteArray framed;
+    if (_framing == QJsonChannelPipeline::NewlineFraming) {
+        framed.reserve (payload.size () + 1);
+        framed += payload;
+        framed += '\n';
+    } else {
+        framed.resize (4);
+        qToBigEndian<quint32> (quint32 (payload.size ()), reinterpret_cast<uchar*> (framed.data ()));
+        framed += payload;
+    }
+
+    if (_sink)
+        _sink (framed);
+    else if (_output)
+        _output->write (framed);
+}
+
+void QJsonChannelPipelinePrivate::resume () {
+    const bool open = inFlight () < _maxInFlight;
+    if (_notifier)
+        _notifier->setEnabled (open);
+    if (open)
+        readDevice ();
+}
+
+void QJsonChannelPipelinePrivate::readDevice () {
+    // the unread data stays in the device while the window is full
+    while (_input && inFlight () < _maxInFlight && _input->bytesAvailable () > 0)
+        feed (_input->read (qMin (_input->bytesAvailable (), qint64 (readChunkSize))));
+}
+
+void QJsonChannelPipelinePrivate::readNotified () {
+#if defined(Q_OS_UNIX)
+    // the descriptor is readable, so one read doesn't block
+    QByteArray    data (readChunkSize, Qt::Uninitialized);
+    const ssize_t size = ::read (fileno (stdin), data.data (), size_t (data.size ()));
+    if (size <= 0) {
+        // end of the input
+        _notifier->setEnabled (false);
+        return;
+    }
+
+    data.resize (int(size));
+    feed (data);
+#endif
+    _notifier->setEnabled (inFlight () < _maxInFlight);
+}
+
+QJsonChannelPipeline::QJsonChannelPipeline (const QJsonChannelServiceRepository* repository, Framing framing, const QJsonChannelCodec* codec)
+    : d (new QJsonChannelPipelinePrivate) {
+    d->_repository = repository;
+    d->_framing    = framing;
+    d->_codec      = codec;
+}
+
+QJsonChannelPipeline::~QJsonChannelPipeline () {
+    QObject::disconnect (d->_readConnection);
+}
+
+void QJsonChannelPipeline::setSink (const std::function<void (const QByteArray&)>& sink) {
+    d->_sink = sink;
+}
+
+void QJsonChannelPipeline::setDevice (QIODevice* input, QIODevice* output) {
+    QObject::disconnect (d->_readConnection);
+    d->_input  = input;
+    d->_output = output ? output : input;
+    if (!input)
+        return;
+
+    QJsonChannelPipelinePrivate* pipeline = d.data ();
+    d->_readConnection = QObject::connect (input, &QIODevice::readyRead, d->_state->_context, [pipeline] () { pipeline->readDevice (); });
+    d->readDevice ();
+}
+
+bool QJsonChannelPipeline::setStandardStreams () {
+#if defined(Q_OS_UNIX)
+    d->_stdout.reset (new QFile);
+    if (!d->_stdout->open (fileno (stdout), QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        d->_stdout.reset ();
+        return false;
+    }
+
+    setDevice (nullptr, d->_stdout.data ());
+
+    QJsonChannelPipelinePrivate* pipeline = d.data ();
+    d->_notifier.reset (new QSocketNotifier (fileno (stdin), QSocketNotifier::Read));
+    QObject::connect (d->_notifier.data (), &QSocketNotifier::activated, d->_state->_context, [pipeline] () { pipeline->readNotified (); });
+    return true;
+#else
+    // stdin can't be watched by QSocketNotifier, feed the pipeline from a reader thread instead
+    return false;
+#endif
+}
+
+void QJsonChannelPipeline::setOrdered (bool ordered) {
+    d->_ordered = ordered;
+}
+
+bool QJsonChannelPipeline::isOrdered () const {
+    return d->_ordered;
+}
+
+void QJsonChannelPipeline::setMaxInFlight (int maxInFlight) {
+    d->_maxInFlight = qMax (1, maxInFlight);
+    d->extract ();
+    d->resume ();
+}
+
+int QJsonChannelPipeline::maxInFlight () const {
+    return d->_maxInFlight;
+}
+
+void QJsonChannelPipeline::setMaxFrameSize (int maxFrameSize) {
+    d->_maxFrameSize = qMax (1, maxFrameSize);
+}
+
+void QJsonChannelPipeline::feed (const QByteArray& data) {
+    d->feed (data);
+}
+
+int QJsonChannelPipeline::inFlight () const {
+    return d->inFlight ();
+}
+
+int QJsonChannelPipeline::bufferedSize () const {
+    return d->_buffer.size () - d->_offset;
+}
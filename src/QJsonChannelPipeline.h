@@ -0,0 +1,139 @@
+#pragma once
+
+#include <QByteArray>
+#include <QScopedPointer>
+
+#include <functional>
+
+#include "QJsonChannelGlobal.h"
+
+class QIODevice;
+class QJsonChannelCodec;
+class QJsonChannelServiceRepository;
+class QJsonChannelPipelinePrivate;
+
+/**
+ * @brief Serves a JSON-RPC byte stream: splits it into frames, dispatches the frames to a service repository on its thread pool
+ * and writes the responses framed in the order of the requests. The input is parsed incrementally as it arrives,
+ * at most maxInFlight frames are dispatched at once and the reading is paused while the window is full.
+ * The pipeline is used from its construction thread, the thread should run an event loop.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelPipeline {
+public:
+    /**
+     * @brief Framing of the messages in the stream
+     *
+     */
+    enum Framing {
+        //! A message per line, the messages should be serialized compactly
+        NewlineFraming,
+        //! A message is preceded by its size, 32-bit big endian
+        LengthPrefixFraming
+    };
+
+    /**
+     * @brief Construct a new QJsonChannelPipeline object
+     *
+     * @param repository Service repository, should outlive the pipeline and its dispatched frames
+     * @param framing Framing of the input and output streams
+     * @param codec Codec of the messages, JSON if it's nullptr
+     */
+    explicit QJsonChannelPipeline (const QJsonChannelServiceRepository* repository, Framing framing = NewlineFraming,
+                                   const QJsonChannelCodec* codec = nullptr);
+
+    /**
+     * @brief Destroys the pipeline, the responses of the frames being dispatched are dropped
+     *
+     */
+    ~QJsonChannelPipeline ();
+
+    /**
+     * @brief Sets the receiver of the framed responses, it's called in the pipeline thread
+     *
+     * @param sink Receives framed output data, the responses are written to the output device if it's not set
+     */
+    void setSink (const std::function<void (const QByteArray&)>& sink);
+
+    /**
+     * @brief Reads the input from a device (QLocalSocket, QProcess, QBuffer...) as it becomes ready and writes the responses to a device.
+     * The unread data stays in the device while the window is full, set the read buffer size of a socket
+     * to make the backpressure reach the peer.
+     *
+     * @param input Input device, nullptr detaches the current one
+     * @param output Output device, the input device if it's nullptr
+     */
+    void setDevice (QIODevice* input, QIODevice* output = nullptr);
+
+    /**
+     * @brief Reads the input from stdin and writes the responses to stdout
+     *
+     * @return true The standard streams are attached
+     * @return false The standard streams can't be watched on this platform
+     */
+    bool setStandardStreams ();
+
+    /**
+     * @brief Writes the responses in the order of the requests or as soon as they are ready.
+     * Unordered responses avoid head-of-line blocking by a slow call, clients match them by id.
+     * Should be called before the input is fed.
+     *
+     * @param ordered Keep the request order, true by default
+     */
+    void setOrdered (bool ordered);
+
+    /**
+     * @brief Returns true if the responses are written in the order of the requests
+     *
+     * @return true
+     * @return false
+     */
+    bool isOrdered () const;
+
+    /**
+     * @brief Sets the maximum number of frames being dispatched or waiting for the earlier responses
+     *
+     * @param maxInFlight Window size, 64 by default
+     */
+    void setMaxInFlight (int maxInFlight);
+
+    /**
+     * @brief Returns the maximum number of frames in flight
+     *
+     * @return int
+     */
+    int maxInFlight () const;
+
+    /**
+     * @brief Sets the maximum size of a frame, a larger frame is skipped and answered with QJsonChannel::ParseError
+     *
+     * @param maxFrameSize Size in bytes, 16 MB by default
+     */
+    void setMaxFrameSize (int maxFrameSize);
+
+    /**
+     * @brief Appends data to the input stream, the complete frames are dispatched while the window is open
+     *
+     * @param data A part of the input stream
+     */
+    void feed (const QByteArray& data);
+
+    /**
+     * @brief Returns the number of frames in flight
+     *
+     * @return int
+     */
+    int inFlight () const;
+
+    /**
+     * @brief Returns the size of the input which is buffered but not dispatched yet
+     *
+     * @return int
+     */
+    int bufferedSize () const;
+
+private:
+    Q_DISABLE_COPY (QJsonChannelPipeline)
+
+    QScopedPointer<QJsonChannelPipelinePrivate> d;
+};
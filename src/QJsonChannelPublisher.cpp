@@ -0,0 +1,291 @@
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMetaMethod>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+#include <QWriteLocker>
+
+#include "QJsonChannelPublisher.h"
+#include "QJsonChannelService.h"
+#include "QJsonChannelServiceRepository.h"
+
+class QJsonChannelPublisherPrivate;
+
+namespace {
+
+// Receives a signal by a dynamic slot, the object has no moc generated meta object
+class QJsonChannelSignalForwarder : public QObject {
+public:
+    QJsonChannelSignalForwarder (const QSharedPointer<QJsonChannelPublisherPrivate>& publisher, const QByteArray& path, const QMetaMethod& signal)
+        : _publisher (publisher), _path (path) {
+        for (int i = 0; i < signal.parameterCount (); ++i)
+            _types.append (signal.parameterType (i));
+    }
+
+    int qt_metacall (QMetaObject::Call call, int id, void** arguments) override;
+
+    QWeakPointer<QJsonChannelPublisherPrivate> _publisher; // the publisher state holds the forwarders
+    QByteArray                                 _path;
+    QVector<int>                               _types;
+    QMetaObject::Connection                    _connection;
+    QAtomicInt                                 _active; // emissions in progress, a retired forwarder is deleted at 0
+
+    // coalescing, guarded by the publisher mutex
+    int        _interval   = 0;
+    qint64     _lastSent   = 0;
+    bool       _sent       = false;
+    bool       _hasPending = false;
+    QJsonArray _pending;
+};
+
+} // namespace
+
+class QJsonChannelPublisherPrivate {
+public:
+    void emitted (QJsonChannelSignalForwarder* forwarder, const QJsonArray& params);
+    void send (const QJsonChannelMessage& notification);
+    void retire (QJsonChannelSignalForwarder* forwarder);
+    void reap ();
+
+    const QJsonChannelServiceRepository* _repository = nullptr;
+    QJsonChannelCompletion               _sink;
+    QElapsedTimer                        _clock;
+    QScopedPointer<QTimer>               _timer;
+
+    // the sink is called under the read lock, the destroyed publisher closes it under the write lock
+    QReadWriteLock _sinkLock {QReadWriteLock::Recursive};
+    bool           _closed = false;
+
+    mutable QMutex                                  _mutex;
+    QHash<QByteArray, QJsonChannelSignalForwarder*> _subscriptions;
+    QList<QJsonChannelSignalForwarder*>             _retired; // disconnected, deleted once no emission is in progress
+    quint64                                         _coalesced = 0;
+};
+
+int QJsonChannelSignalForwarder::qt_metacall (QMetaObject::Call call, int id, void** arguments) {
+    id = QObject::qt_metacall (call, id, arguments);
+    if (id < 0 || call != QMetaObject::InvokeMetaMethod)
+        return id;
+
+    if (id == 0) {
+        _active.ref ();
+        // arguments[0] is the return value
+        QJsonArray params;
+        for (int i = 0; i < _types.size (); ++i) {
+            const int type = _types.at (i);
+            if (type == QMetaType::UnknownType) {
+                params.append (QJsonValue ());
+                continue;
+            }
+            const QVariant value = type == QMetaType::QVariant ? *static_cast<const QVariant*> (arguments[i + 1]) : QVariant (type, arguments[i + 1]);
+            params.append (QJsonValue::fromVariant (value));
+        }
+        if (QSharedPointer<QJsonChannelPublisherPrivate> publisher = _publisher.toStrongRef ())
+            publisher->emitted (this, params);
+        _active.deref ();
+    }
+    return id - 1;
+}
+
+void QJsonChannelPublisherPrivate::emitted (QJsonChannelSignalForwarder* forwarder, const QJsonArray& params) {
+    {
+        QMutexLocker lock (&_mutex);
+        const qint64 now = _clock.elapsed ();
+        if (forwarder->_interval > 0 && forwarder->_sent && now - forwarder->_lastSent < forwarder->_interval) {
+            // the last emission within the interval wins
+            if (forwarder->_hasPending)
+                ++_coalesced;
+            forwarder->_pending    = params;
+            forwarder->_hasPending = true;
+            return;
+        }
+        forwarder->_sent       = true;
+        forwarder->_lastSent   = now;
+        forwarder->_hasPending = false;
+    }
+    send (QJsonChannelMessage::createNotification (QString::fromLatin1 (forwarder->_path), params));
+}
+
+void QJsonChannelPublisherPrivate::send (const QJsonChannelMessage& notification) {
+    QReadLocker lock (&_sinkLock);
+    if (!_closed)
+        _sink (notification);
+}
+
+void QJsonChannelPublisherPrivate::retire (QJsonChannelSignalForwarder* forwarder) {
+    QObject::disconnect (forwarder->_connection);
+    // an emission in progress on another thread may still use it, it's deleted by a later reap
+    _retired.append (forwarder);
+}
+
+void QJsonChannelPublisherPrivate::reap () {
+    for (auto it = _retired.begin (); it != _retired.end ();) {
+        if ((*it)->_active.loadAcquire ()) {
+            ++it;
+            continue;
+        }
+        delete *it;
+        it = _retired.erase (it);
+    }
+}
+
+QJsonChannelPublisher::QJsonChannelPublisher (const QJsonChannelServiceRepository* repository, const QJsonChannelCompletion& sink, int resolution)
+    : d (new QJsonChannelPublisherPrivate) {
+    d->_repository = repository;
+    d->_sink       = sink;
+    d->_clock.start ();
+
+    // one timer for all the subscriptions
+    if (QCoreApplication::instance ()) {
+        d->_timer.reset (new QTimer);
+        d->_timer->setInterval (qMax (1, resolution));
+        QObject::connect (d->_timer.data (), &QTimer::timeout, [this] () { flush (); });
+        d->_timer->start ();
+    }
+}
+
+QJsonChannelPublisher::~QJsonChannelPublisher () {
+    d->_timer.reset ();
+    {
+        QWriteLocker lock (&d->_sinkLock);
+        d->_closed = true;
+    }
+
+    QList<QJsonChannelSignalForwarder*> forwarders;
+    {
+        QMutexLocker lock (&d->_mutex);
+        for (QJsonChannelSignalForwarder* forwarder : d->_subscriptions)
+            QObject::disconnect (forwarder->_connection);
+        forwarders = d->_subscriptions.values () + d->_retired;
+        d->_subscriptions.clear ();
+        d->_retired.clear ();
+    }
+
+    // the sink is closed, the emissions in progress end without sending, an emission takes the mutex
+    for (QJsonChannelSignalForwarder* forwarder : forwarders) {
+        while (forwarder->_active.loadAcquire ())
+            QThread::yieldCurrentThread ();
+        delete forwarder;
+    }
+}
+
+bool QJsonChannelPublisher::subscribe (const QByteArray& signalPath, int interval) {
+    const int dot = signalPath.lastIndexOf ('.');
+    if (dot <= 0)
+        return false;
+
+    QMutexLocker lock (&d->_mutex);
+    d->reap ();
+    auto it = d->_subscriptions.constFind (signalPath);
+    if (it != d->_subscriptions.constEnd ()) {
+        it.value ()->_interval = qMax (0, interval);
+        return true;
+    }
+
+    QSharedPointer<QJsonChannelService> service = d->_repository->getService (signalPath.left (dot));
+    if (!service)
+        return false;
+
+    const QByteArray   signalName = signalPath.mid (dot + 1);
+    QObject*           object     = service->serviceObj ().data ();
+    const QMetaObject* metaObject = object->metaObject ();
+    for (int idx = 0; idx < metaObject->methodCount (); ++idx) {
+        const QMetaMethod method = metaObject->method (idx);
+        if (method.methodType () != QMetaMethod::Signal || method.name () != signalName)
+            continue;
+
+        QJsonChannelSignalForwarder* forwarder = new QJsonChannelSignalForwarder (d, signalPath, method);
+        forwarder->_interval                   = qMax (0, interval);
+
+        // the dynamic slot follows the QObject methods, the slot runs on the emitting thread
+        forwarder->_connection = QMetaObject::connect (object, idx, forwarder, QObject::staticMetaObject.methodCount (), Qt::DirectConnection);
+        if (!forwarder->_connection) {
+            delete forwarder;
+            return false;
+        }
+
+        d->_subscriptions.insert (signalPath, forwarder);
+        return true;
+    }
+
+    QJsonChannelDebug () << Q_FUNC_INFO << "signal" << signalPath << "not found";
+    return false;
+}
+
+bool QJsonChannelPublisher::unsubscribe (const QByteArray& signalPath) {
+    QMutexLocker lock (&d->_mutex);
+    d->reap ();
+    QJsonChannelSignalForwarder* forwarder = d->_subscriptions.take (signalPath);
+    if (!forwarder)
+        return false;
+
+    d->retire (forwarder);
+    return true;
+}
+
+QJsonChannelMessage QJsonChannelPublisher::processMessage (const QJsonChannelMessage& message) {
+    if (message.type () != QJsonChannelMessage::Request && message.type () != QJsonChannelMessage::Notification)
+        return QJsonChannelMessage ();
+
+    const QByteArray& method = message.methodPath ();
+    if (method != "__subscribe__" && method != "__unsubscribe__")
+        return QJsonChannelMessage ();
+
+    const QJsonValue params = message.params ();
+    QJsonValue       signal;
+    QJsonValue       interval;
+    if (params.isObject ()) {
+        signal   = params.toObject ().value (QLatin1String ("signal"));
+        interval = params.toObject ().value (QLatin1String ("interval"));
+    } else {
+        signal   = params.toArray ().at (0);
+        interval = params.toArray ().at (1);
+    }
+    if (!signal.isString ())
+        return message.createErrorResponse (QJsonChannel::InvalidParams, "signal expected");
+
+    const QByteArray signalPath = signal.toString ().toLatin1 ();
+    const bool       success    = method == "__subscribe__" ? subscribe (signalPath, interval.toInt ()) : unsubscribe (signalPath);
+    if (!success)
+        return message.createErrorResponse (QJsonChannel::InvalidParams, QString ("signal '%1' not found").arg (signal.toString ()));
+    if (message.type () == QJsonChannelMessage::Notification)
+        return QJsonChannelMessage ();
+    return message.createResponse (QJsonValue (true));
+}
+
+int QJsonChannelPublisher::flush () {
+    QList<QJsonChannelMessage> notifications;
+    {
+        QMutexLocker lock (&d->_mutex);
+        d->reap ();
+        const qint64 now = d->_clock.elapsed ();
+        for (QJsonChannelSignalForwarder* forwarder : d->_subscriptions) {
+            if (!forwarder->_hasPending || now - forwarder->_lastSent < forwarder->_interval)
+                continue;
+
+            notifications.append (QJsonChannelMessage::createNotification (QString::fromLatin1 (forwarder->_path), forwarder->_pending));
+            forwarder->_lastSent   = now;
+            forwarder->_hasPending = false;
+            forwarder->_pending    = QJsonArray ();
+        }
+    }
+
+    for (const QJsonChannelMessage& notification : notifications)
+        d->send (notification);
+    return notifications.size ();
+}
+
+quint64 QJsonChannelPublisher::coalesced () const {
+    QMutexLocker lock (&d->_mutex);
+    return d->_coalesced;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QSharedPointer>
+
+#include "QJsonChannelMessage.h"
+
+class QJsonChannelServiceRepository;
+class QJsonChannelPublisherPrivate;
+
+/**
+ * @brief Forwards the signals of the service objects to a client as JSON-RPC notifications "service.signal" with the signal arguments as params.
+ * A subscription may coalesce a high-frequency signal: at most one notification per interval is sent, the last arguments win.
+ * A publisher serves one client, clients subscribe by "__subscribe__" and "__unsubscribe__" requests handled by processMessage.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelPublisher {
+public:
+    /**
+     * @brief Construct a new QJsonChannelPublisher object. The coalescing timer runs in the thread of the construction
+     * if it has an event loop, otherwise flush should be called periodically.
+     *
+     * @param repository Service repository of the subscribed services
+     * @param sink Receives the notifications, it's called on the emitting threads and on the timer thread.
+     * It isn't called anymore once the publisher is destroyed, so it shouldn't destroy the publisher itself
+     * @param resolution Coalescing timer precision in milliseconds
+     */
+    QJsonChannelPublisher (const QJsonChannelServiceRepository* repository, const QJsonChannelCompletion& sink, int resolution = 10);
+
+    /**
+     * @brief Destroys the publisher and its subscriptions, coalesced notifications are dropped.
+     * Waits for a notification being delivered to the sink, the emissions in progress send nothing afterwards.
+     *
+     */
+    ~QJsonChannelPublisher ();
+
+    /**
+     * @brief Subscribes to a signal of a service object, the interval of an existing subscription is updated
+     *
+     * @param signalPath "service.signal"
+     * @param interval Coalescing window in milliseconds, every emission is sent if it's 0
+     * @return true The signal is subscribed
+     * @return false The service or its signal is not found
+     */
+    bool subscribe (const QByteArray& signalPath, int interval = 0);
+
+    /**
+     * @brief Cancels a subscription
+     *
+     * @param signalPath "service.signal"
+     * @return true The subscription was canceled
+     * @return false The signal was not subscribed
+     */
+    bool unsubscribe (const QByteArray& signalPath);
+
+    /**
+     * @brief Handles subscription requests, {"signal": "service.signal", "interval": 100} or ["service.signal", 100] params
+     *
+     * @param message JSON-RPC message
+     * @return QJsonChannelMessage The response of a subscription request, invalid message if it's not a subscription request
+     */
+    QJsonChannelMessage processMessage (const QJsonChannelMessage& message);
+
+    /**
+     * @brief Sends the coalesced notifications whose interval is over
+     *
+     * @return int Number of the sent notifications
+     */
+    int flush ();
+
+    /**
+     * @brief Returns the number of emissions replaced by later ones within their interval
+     *
+     * @return quint64
+     */
+    quint64 coalesced () const;
+
+private:
+    Q_DISABLE_COPY (QJsonChannelPublisher)
+
+    // shared with the forwarders, an emission in progress on another thread may outlive the publisher
+    QSharedPointer<QJsonChannelPublisherPrivate> d;
+};
@@ -1,12 +1,25 @@
+#include <QCborArray>
+#include <QCborMap>
 #include <QVarLengthArray>
+#include <QMetaClassInfo>
 #include <QMetaMethod>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QJsonDocument>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QPointer>
+#include <QReadWriteLock>
 #include <QStringList>
 
+#include <algorithm>
+#include <new>
+#include <type_traits>
+
+#include "QJsonChannelExecutor.h"
+#include "QJsonChannelFuture.h"
+#include "QJsonChannelMetrics.h"
 #include "QJsonChannelService.h"
 
 class QJsonChannelServiceRequestPrivate : public QSharedData {
@@ -16,12 +29,216 @@ public:
 
 class QJsonChannelService;
 
+// Storage of a natively marshaled argument or return value
+typedef std::aligned_storage<32, alignof (double)>::type QJsonChannelArgumentStorage;
+
+// Type-specialized conversion between JSON values and native values in QJsonChannelArgumentStorage
+struct QJsonChannelMarshaler {
+    // constructs the native value, returns false if the JSON value requires the generic QVariant conversion
+    bool (*construct) (void* storage, const QJsonValue& argument);
+    void (*destroy) (void* storage);
+    QJsonValue (*toJson) (const void* storage);
+};
+
+template <typename T>
+struct QJsonChannelNativeMarshaler {
+    Q_STATIC_ASSERT (sizeof (T) <= sizeof (QJsonChannelArgumentStorage));
+
+    static bool construct (void* storage, const QJsonValue& argument) {
+        // missing arguments are default constructed as QVariant (type, nullptr) does
+        if (argument.isUndefined ()) {
+            new (storage) T ();
+            return true;
+        }
+        if (!QJsonChannelJsonTraits<T>::accepts (argument))
+            return false;
+
+        new (storage) T (QJsonChannelJsonTraits<T>::fromJson (argument));
+        return true;
+    }
+    static void destroy (void* storage) {
+        static_cast<T*> (storage)->~T ();
+    }
+    static QJsonValue toJson (const void* storage) {
+        return QJsonChannelJsonTraits<T>::toJson (*static_cast<const T*> (storage));
+    }
+
+    static const QJsonChannelMarshaler marshaler;
+};
+
+template <typename T>
+const QJsonChannelMarshaler QJsonChannelNativeMarshaler<T>::marshaler = {&QJsonChannelNativeMarshaler<T>::construct, &QJsonChannelNativeMarshaler<T>::destroy,
+                                                                         &QJsonChannelNativeMarshaler<T>::toJson};
+
+static const QJsonChannelMarshaler* findMarshaler (int type) {
+    switch (type) {
+    case QMetaType::Int:
+        return &QJsonChannelNativeMarshaler<int>::marshaler;
+    case QMetaType::UInt:
+        return &QJsonChannelNativeMarshaler<uint>::marshaler;
+    case QMetaType::LongLong:
+        return &QJsonChannelNativeMarshaler<qlonglong>::marshaler;
+    case QMetaType::ULongLong:
+        return &QJsonChannelNativeMarshaler<qulonglong>::marshaler;
+    case QMetaType::Double:
+        return &QJsonChannelNativeMarshaler<double>::marshaler;
+    case QMetaType::Float:
+        return &QJsonChannelNativeMarshaler<float>::marshaler;
+    case QMetaType::Bool:
+        return &QJsonChannelNativeMarshaler<bool>::marshaler;
+    case QMetaType::QString:
+        return &QJsonChannelNativeMarshaler<QString>::marshaler;
+    case QMetaType::QJsonValue:
+        return &QJsonChannelNativeMarshaler<QJsonValue>::marshaler;
+    case QMetaType::QJsonObject:
+        return &QJsonChannelNativeMarshaler<QJsonObject>::marshaler;
+    case QMetaType::QJsonArray:
+        return &QJsonChannelNativeMarshaler<QJsonArray>::marshaler;
+    default:
+        return nullptr;
+    }
+}
+
+// Natively marshaled values of an invocation, destroyed when the invocation is over
+class QJsonChannelNativeArguments {
+public:
+    explicit QJsonChannelNativeArguments (int size) : _storage (size), _marshalers (size) {
+        for (int i = 0; i < size; ++i)
+            _marshalers[i] = nullptr;
+    }
+    ~QJsonChannelNativeArguments () {
+        for (int i = 0; i < _marshalers.size (); ++i) {
+            if (_marshalers[i])
+                _marshalers[i]->destroy (&_storage[i]);
+        }
+    }
+
+    bool construct (int index, const QJsonChannelMarshaler* marshaler, const QJsonValue& argument) {
+        if (!marshaler || !marshaler->construct (&_storage[index], argument))
+            return false;
+        _marshalers[index] = marshaler;
+        return true;
+    }
+    bool isNative (int index) const {
+        return _marshalers[index] != nullptr;
+    }
+    void* data (int index) {
+        return &_storage[index];
+    }
+    QJsonValue toJson (int index) const {
+        return _marshalers[index]->toJson (&_storage[index]);
+    }
+
+private:
+    Q_DISABLE_COPY (QJsonChannelNativeArguments)
+
+    QVarLengthArray<QJsonChannelArgumentStorage, 10>   _storage;
+    QVarLengthArray<const QJsonChannelMarshaler*, 10> _marshalers;
+};
+
+// Completion of a message whose result is delivered by a QFuture
+struct QJsonChannelDeferred {
+    QJsonChannelCompletion _completion;
+    bool                   _pending = false;
+};
+
+// Serialized results of a cached method by its canonical parameters
+class QJsonChannelResultCache {
+public:
+    QJsonChannelResultCache (int ttl, int maxEntries) : _ttl (ttl), _maxEntries (qMax (1, maxEntries)) {}
+
+    // returns the generation to pass to insert on a miss
+    bool lookup (const QByteArray& key, qint64 now, QByteArray* result, quint64* generation) const {
+        QMutexLocker lock (&_mutex);
+        *generation = _generation;
+
+        const auto it = _entries.constFind (key);
+        if (it == _entries.constEnd () || it.value ().second <= now)
+            return false;
+        *result = it.value ().first;
+        return true;
+    }
+
+    void insert (const QByteArray& key, const QByteArray& result, qint64 now, quint64 generation) {
+        QMutexLocker lock (&_mutex);
+        // the result may be computed before an invalidation
+        if (generation != _generation)
+            return;
+
+        if (_entries.size () >= _maxEntries) {
+            for (auto it = _entries.begin (); it != _entries.end ();) {
+                if (it.value ().second <= now)
+                    it = _entries.erase (it);
+                else
+                    ++it;
+            }
+            if (_entries.size () >= _maxEntries)
+                _entries.clear ();
+        }
+        _entries.insert (key, qMakePair (result, now + _ttl));
+    }
+
+    void clear () {
+        QMutexLocker lock (&_mutex);
+        ++_generation;
+        _entries.clear ();
+    }
+
+private:
+    const int _ttl;
+    const int _maxEntries;
+
+    mutable QMutex                               _mutex;
+    quint64                                      _generation = 0;
+    QHash<QByteArray, QPair<QByteArray, qint64>> _entries; // parameters -> (result, expiration time)
+};
+
+// Clears a result cache by a NOTIFY signal, the dynamic slot follows the QObject methods
+class QJsonChannelCacheInvalidator : public QObject {
+public:
+    explicit QJsonChannelCacheInvalidator (const QSharedPointer<QJsonChannelResultCache>& cache) : _cache (cache) {}
+
+    int qt_metacall (QMetaObject::Call call, int id, void** arguments) override {
+        id = QObject::qt_metacall (call, id, arguments);
+        if (id < 0 || call != QMetaObject::InvokeMetaMethod)
+            return id;
+        if (id == 0)
+            _cache->clear ();
+        return id - 1;
+    }
+
+private:
+    QSharedPointer<QJsonChannelResultCache> _cache;
+};
+
+struct QJsonChannelService::Method {
+    // candidates in the order of matching: (0 - method, 1 - getter, 2 - setter; method or property index)
+    QList<QPair<int, int>> _candidates;
+
+    // positional calls: signature (arity and JSON types of the arguments) -> index of the matching candidate
+    QHash<quint64, int> _signatures;
+    // every positional call which may match is in _signatures, a missed signature is an invalid call
+    bool _exhaustive = false;
+
+    // index of the typed invoker which replaces the candidates, -1 for reflected methods
+    int _typed = -1;
+
+    // serialized results by parameters, null if the method isn't cached
+    QSharedPointer<QJsonChannelResultCache> _cache;
+};
+
 class QJsonChannelServicePrivate {
 public:
     QJsonChannelServicePrivate (const QByteArray& name, const QByteArray& version, const QByteArray& description, QSharedPointer<QObject> obj, bool threadSafe)
         : _serviceName (name), _serviceVersion (version), _serviceDescription (description), _serviceObj (obj), _isServiceObjThreadSafe (threadSafe) {
+        _clock.start ();
         cacheInvokableInfo ();
     }
+    ~QJsonChannelServicePrivate () {
+        // the queued invocations refer to the service
+        _executor.reset ();
+        qDeleteAll (_invalidators);
+    }
 
     QJsonObject createServiceInfo () const;
 
@@ -30,28 +247,48 @@ public:
     static int        convertVariantTypeToJSType (int type);
     static QJsonValue convertReturnValue (QVariant& returnValue);
 
-    QJsonChannelMessage invokeMethod (int methodIndex, const QJsonChannelMessage& request) const;
+    void                compileSignatures (QJsonChannelService::Method& method) const;
+    bool                setResultCache (const QByteArray& name, int ttl, int maxEntries);
+    QJsonChannelMessage dispatch (const QJsonChannelMessage& request, const QJsonChannelService::Method* method, QJsonChannelDeferred* deferred) const;
+    QJsonChannelMessage dispatchMethod (const QJsonChannelMessage& request, const QJsonChannelService::Method* method,
+                                        QJsonChannelDeferred* deferred) const;
+    QJsonChannelMessage invokeCandidate (const QPair<int, int>& candidate, const QJsonChannelMessage& request, QJsonChannelDeferred* deferred) const;
+    void dispatch (const QJsonChannelMessage& request, const QJsonChannelService::Method* method, const QJsonChannelCompletion& completion) const;
+    QJsonChannelMessage invokeMethod (int methodIndex, const QJsonChannelMessage& request, QJsonChannelDeferred* deferred,
+                                      const QJsonValue* boundArguments = nullptr) const;
     QJsonChannelMessage callGetter (int propertyIndex, const QJsonChannelMessage& request) const;
     QJsonChannelMessage callSetter (int propertyIndex, const QJsonChannelMessage& request) const;
+    QJsonChannelMessage invokeTyped (int typedIndex, const QJsonChannelMessage& request) const;
 
     struct ParameterInfo {
         ParameterInfo (const QString& name = QString (), int type = 0, bool out = false);
 
-        int     _type;
-        int     _jsType;
-        QString _name;
-        bool    _out;
+        int                          _type;
+        int                          _jsType;
+        QString                      _name;
+        bool                         _out;
+        const QJsonChannelMarshaler* _marshaler;
     };
 
     struct MethodInfo {
         MethodInfo ();
         MethodInfo (const QMetaMethod& method);
 
-        QVarLengthArray<ParameterInfo> _parameters;
-        int                            _returnType;
-        bool                           _valid;
-        bool                           _hasOut;
-        QString                        _name;
+        QVarLengthArray<ParameterInfo>   _parameters;
+        QVector<QPair<QString, int>>     _sortedNames; // (parameter name, parameter index) sorted by name
+        int                              _returnType;
+        const QJsonChannelMarshaler*     _returnMarshaler;
+        const QJsonChannelFutureAdapter* _futureAdapter;
+        bool                             _valid;
+        bool                             _hasOut;
+        bool                             _readOnly;
+        QString                          _name;
+    };
+
+    struct TypedMethodInfo {
+        QString                 _name;
+        QStringList             _parameterNames;
+        QJsonChannelTypedMethod _method;
     };
 
     struct PropInfo {
@@ -68,7 +305,8 @@ public:
 
     QHash<int, MethodInfo>                    _methodInfoHash;
     QHash<int, PropInfo>                      _propertyInfoHash;
-    QHash<QByteArray, QList<QPair<int, int>>> _invokableMethodHash;
+    QVector<TypedMethodInfo>                  _typedMethodInfos;
+    QHash<QByteArray, QJsonChannelService::Method> _invokableMethodHash;
 
     QJsonObject _serviceInfo;
 
@@ -77,21 +315,71 @@ public:
     QString                 _serviceVersion;
     QString                 _serviceDescription;
 
-    bool           _isServiceObjThreadSafe = false;
-    mutable QMutex _serviceMutex;
+    bool                   _isServiceObjThreadSafe = false;
+    bool                   _readWriteLocking       = false;
+    mutable QMutex         _serviceMutex;
+    mutable QReadWriteLock _serviceLock;
+
+    QJsonChannelService::ExecutorMode    _executorMode = QJsonChannelService::NoExecutor;
+    QScopedPointer<QJsonChannelExecutor> _executor;
+
+    // result caches of the getters by property index, cleared by the setters and by the NOTIFY invalidators
+    QHash<int, QSharedPointer<QJsonChannelResultCache>> _propertyCaches;
+    QHash<int, QJsonChannelCacheInvalidator*>           _invalidators;
+    QElapsedTimer                                       _clock;
+
+    // the methods are handed out by pointers (a repository dispatch table), the method hash can't change anymore
+    mutable QAtomicInt _published;
+};
+
+// Guards the service object access unless it's thread safe or serialized by the executor
+class QJsonChannelServiceLocker {
+public:
+    QJsonChannelServiceLocker (const QJsonChannelServicePrivate* d, bool readOnly) {
+        if (d->_isServiceObjThreadSafe || d->_executor)
+            return;
+
+        QJsonChannelMetrics::StageTimer wait (QJsonChannelMetrics::LockWait);
+        if (!d->_readWriteLocking) {
+            _mutex = &d->_serviceMutex;
+            _mutex->lock ();
+        } else {
+            _lock = &d->_serviceLock;
+            if (readOnly)
+                _lock->lockForRead ();
+            else
+                _lock->lockForWrite ();
+        }
+    }
+    ~QJsonChannelServiceLocker () {
+        if (_mutex)
+            _mutex->unlock ();
+        if (_lock)
+            _lock->unlock ();
+    }
+
+private:
+    Q_DISABLE_COPY (QJsonChannelServiceLocker)
+
+    QMutex*         _mutex = nullptr;
+    QReadWriteLock* _lock  = nullptr;
 };
 
 QJsonChannelServicePrivate::ParameterInfo::ParameterInfo (const QString& n, int t, bool o)
-    : _type (t), _jsType (convertVariantTypeToJSType (t)), _name (n), _out (o) {
+    : _type (t), _jsType (convertVariantTypeToJSType (t)), _name (n), _out (o), _marshaler (findMarshaler (t)) {
 }
 
-QJsonChannelServicePrivate::MethodInfo::MethodInfo () : _returnType (QMetaType::Void), _valid (false), _hasOut (false) {
+QJsonChannelServicePrivate::MethodInfo::MethodInfo ()
+    : _returnType (QMetaType::Void), _returnMarshaler (nullptr), _futureAdapter (nullptr), _valid (false), _hasOut (false), _readOnly (false) {
 }
 
-QJsonChannelServicePrivate::MethodInfo::MethodInfo (const QMetaMethod& method) : _returnType (QMetaType::Void), _valid (true), _hasOut (false) {
+QJsonChannelServicePrivate::MethodInfo::MethodInfo (const QMetaMethod& method)
+    : _returnType (QMetaType::Void), _returnMarshaler (nullptr), _futureAdapter (nullptr), _valid (true), _hasOut (false), _readOnly (false) {
     _name = method.name ();
 
-    _returnType = method.returnType ();
+    _returnType      = method.returnType ();
+    _returnMarshaler = findMarshaler (_returnType);
+    _futureAdapter   = QJsonChannelFutureAdapter::adapter (_returnType);
     if (_returnType == QMetaType::UnknownType) {
         QJsonChannelDebug () << "QJsonChannelService: can't bind method's return type" << QString (_name);
         _valid = false;
@@ -121,6 +409,10 @@ QJsonChannelServicePrivate::MethodInfo::MethodInfo (const QMetaMethod& method) :
 
         _parameters.append (ParameterInfo (parameterName, type, out));
     }
+
+    for (int i = 0; i < _parameters.size (); ++i)
+        _sortedNames.append (qMakePair (_parameters.at (i)._name, i));
+    std::sort (_sortedNames.begin (), _sortedNames.end ());
 }
 
 QJsonChannelServicePrivate::PropInfo::PropInfo (QMetaProperty info) {
@@ -144,6 +436,8 @@ QJsonChannelService::QJsonChannelService (const QByteArray& name, const QByteArr
 }
 
 QJsonChannelService::~QJsonChannelService () {
+    // a removed service lives until its queued dispatches are run or answered with an error
+    d_ptr->_executor.reset ();
 }
 
 QSharedPointer<QObject> QJsonChannelService::serviceObj () {
@@ -154,6 +448,141 @@ const QByteArray& QJsonChannelService::serviceName () const {
     return d_ptr->_serviceName;
 }
 
+bool QJsonChannelService::isThreadSafe () const {
+    return d_ptr->_isServiceObjThreadSafe;
+}
+
+bool QJsonChannelService::setExecutor (ExecutorMode mode, QThreadPool* pool) {
+    QJsonChannelServicePrivate* d = d_ptr.get ();
+    if (d->_isServiceObjThreadSafe)
+        return false;
+    if (d->_published.loadAcquire ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service" << d->_serviceName << "is already published";
+        return false;
+    }
+
+    d->_executorMode = mode;
+    switch (mode) {
+    case PoolExecutor:
+        d->_executor.reset (new QJsonChannelExecutor (pool));
+        break;
+    case ObjectThreadExecutor:
+        d->_executor.reset (new QJsonChannelExecutor (d->_serviceObj.data ()));
+        break;
+    default:
+        d->_executor.reset ();
+        break;
+    }
+    return true;
+}
+
+QJsonChannelService::ExecutorMode QJsonChannelService::executorMode () const {
+    return d_ptr->_executorMode;
+}
+
+bool QJsonChannelService::setReadWriteLocking (bool enabled) {
+    if (d_ptr->_published.loadAcquire ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service" << d_ptr->_serviceName << "is already published";
+        return false;
+    }
+    d_ptr->_readWriteLocking = enabled;
+    return true;
+}
+
+bool QJsonChannelService::readWriteLocking () const {
+    return d_ptr->_readWriteLocking;
+}
+
+bool QJsonChannelService::setReadOnlyMethods (const QList<QByteArray>& methods) {
+    QJsonChannelServicePrivate* d = d_ptr.get ();
+    if (d->_published.loadAcquire ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service" << d->_serviceName << "is already published";
+        return false;
+    }
+    for (auto it = d->_methodInfoHash.begin (); it != d->_methodInfoHash.end (); ++it) {
+        if (methods.contains (it.value ()._name.toLatin1 ()))
+            it.value ()._readOnly = true;
+    }
+    return true;
+}
+
+bool QJsonChannelService::setResultCache (const QByteArray& method, int ttl, int maxEntries) {
+    if (d_ptr->_published.loadAcquire ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service" << d_ptr->_serviceName << "is already published";
+        return false;
+    }
+    return d_ptr->setResultCache (method, ttl, maxEntries);
+}
+
+void QJsonChannelService::invalidateResultCache (const QByteArray& method) {
+    const QJsonChannelServicePrivate* d  = d_ptr.get ();
+    const auto                        it = d->_invokableMethodHash.constFind (method);
+    if (it != d->_invokableMethodHash.constEnd () && it.value ()._cache)
+        it.value ()._cache->clear ();
+}
+
+bool QJsonChannelServicePrivate::setResultCache (const QByteArray& name, int ttl, int maxEntries) {
+    auto it = _invokableMethodHash.find (name);
+    if (it == _invokableMethodHash.end ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "method" << name << "not found";
+        return false;
+    }
+
+    QJsonChannelService::Method& method = it.value ();
+    for (const QPair<int, int>& candidate : method._candidates) {
+        if (candidate.first != 1)
+            continue;
+        _propertyCaches.remove (candidate.second);
+        // the replaced cache isn't cleared by the NOTIFY signal anymore, deleting the invalidator disconnects it
+        delete _invalidators.take (candidate.second);
+    }
+    method._cache.reset ();
+    if (ttl <= 0)
+        return true;
+
+    method._cache.reset (new QJsonChannelResultCache (ttl, maxEntries));
+    for (const QPair<int, int>& candidate : method._candidates) {
+        if (candidate.first != 1)
+            continue;
+        _propertyCaches.insert (candidate.second, method._cache);
+
+        const QMetaProperty prop = _propertyInfoHash.value (candidate.second)._prop;
+        if (!prop.hasNotifySignal ())
+            continue;
+        QJsonChannelCacheInvalidator* invalidator = new QJsonChannelCacheInvalidator (method._cache);
+        QMetaObject::connect (_serviceObj.data (), prop.notifySignalIndex (), invalidator, QObject::staticMetaObject.methodCount (),
+                              Qt::DirectConnection);
+        _invalidators.insert (candidate.second, invalidator);
+    }
+    return true;
+}
+
+bool QJsonChannelService::registerMethod (const QByteArray& name, const QJsonChannelTypedMethod& method, const QStringList& parameterNames) {
+    QJsonChannelServicePrivate* d = d_ptr.get ();
+    if (d->_published.loadAcquire ()) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service" << d->_serviceName << "is already published";
+        return false;
+    }
+    if (!method.invoke || !method.accepts (d->_serviceObj.data ())) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "service object is not an instance of the class of" << name;
+        return false;
+    }
+    if (!parameterNames.isEmpty () && parameterNames.size () != method.arity) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "wrong number of parameter names for" << name;
+        return false;
+    }
+
+    QJsonChannelServicePrivate::TypedMethodInfo info;
+    info._name           = QString::fromLatin1 (name);
+    info._parameterNames = parameterNames;
+    info._method         = method;
+    d->_typedMethodInfos.append (info);
+
+    d->_invokableMethodHash[name]._typed = d->_typedMethodInfos.size () - 1;
+    d->_serviceInfo                      = d->createServiceInfo ();
+    return true;
+}
+
 const QJsonObject& QJsonChannelService::serviceInfo () const {
     return d_ptr->_serviceInfo;
 }
@@ -266,6 +695,25 @@ QJsonObject QJsonChannelServicePrivate::createServiceInfo () const {
         }
     }
 
+    for (const TypedMethodInfo& info : _typedMethodInfos) {
+        QJsonObject method_desc;
+        method_desc["summary"]     = info._name;
+        method_desc["description"] = info._name;
+
+        QJsonObject properties;
+        for (int i = 0; i < info._method.arity; ++i) {
+            const QString name = i < info._parameterNames.size () ? info._parameterNames.at (i) : QString ("arg%1").arg (i);
+            properties[name]   = createParameterDescription (name, info._method.parameterTypes[i]);
+        }
+        QJsonObject params;
+        params["type"]       = "object";
+        params["properties"] = properties;
+
+        method_desc["params"] = params;
+        method_desc["result"] = createParameterDescription ("return value", info._method.returnType);
+        qtMethods[info._name] = method_desc;
+    }
+
     data["methods"] = qtMethods;
     return data;
 }
@@ -307,6 +755,27 @@ void QJsonChannelServicePrivate::cacheInvokableInfo () {
     QSharedPointer<QObject>& q        = _serviceObj;
     const QMetaObject*       meta_obj = q->metaObject ();
     int                      startIdx = q->staticMetaObject.methodCount (); // skip QObject slots
+
+    // Q_CLASSINFO ("QJsonChannelReadOnly", "method1,method2") marks methods which don't modify the service object
+    // Q_CLASSINFO ("QJsonChannelCached", "method1:ttl1,method2:ttl2") caches the results of methods and getters, ttl in milliseconds
+    QList<QByteArray>             readOnlyMethods;
+    QList<QPair<QByteArray, int>> cachedMethods;
+    for (int idx = 0; idx < meta_obj->classInfoCount (); ++idx) {
+        const QMetaClassInfo classInfo = meta_obj->classInfo (idx);
+        if (qstrcmp (classInfo.name (), "QJsonChannelCached") == 0) {
+            for (const QByteArray& entry : QByteArray (classInfo.value ()).split (',')) {
+                const int colon = entry.indexOf (':');
+                if (colon > 0)
+                    cachedMethods.append (qMakePair (entry.left (colon).trimmed (), entry.mid (colon + 1).trimmed ().toInt ()));
+            }
+            continue;
+        }
+        if (qstrcmp (classInfo.name (), "QJsonChannelReadOnly") != 0)
+            continue;
+        for (const QByteArray& name : QByteArray (classInfo.value ()).split (','))
+            readOnlyMethods.append (name.trimmed ());
+    }
+
     for (int idx = startIdx; idx < meta_obj->methodCount (); ++idx) {
         const QMetaMethod method = meta_obj->method (idx);
         if (method.access () == QMetaMethod::Public || method.methodType () == QMetaMethod::Signal) {
@@ -316,11 +785,12 @@ void QJsonChannelServicePrivate::cacheInvokableInfo () {
             MethodInfo info (method);
             if (!info._valid)
                 continue;
+            info._readOnly = readOnlyMethods.contains (methodName);
 
             if (signature.contains ("QVariant"))
-                _invokableMethodHash[methodName].append (QPair<int, int> (0, idx));
+                _invokableMethodHash[methodName]._candidates.append (QPair<int, int> (0, idx));
             else
-                _invokableMethodHash[methodName].prepend (QPair<int, int> (0, idx));
+                _invokableMethodHash[methodName]._candidates.prepend (QPair<int, int> (0, idx));
 
             _methodInfoHash[idx] = info;
         }
@@ -332,23 +802,29 @@ void QJsonChannelServicePrivate::cacheInvokableInfo () {
         PropInfo propInfo (info);
 
         if (propInfo._getterName.isEmpty () == false) {
-            _invokableMethodHash[propInfo._getterName.toLatin1 ()].append (QPair<int, int> (1, idx));
+            _invokableMethodHash[propInfo._getterName.toLatin1 ()]._candidates.append (QPair<int, int> (1, idx));
         }
         if (propInfo._setterName.isEmpty () == false) {
-            _invokableMethodHash[propInfo._setterName.toLatin1 ()].append (QPair<int, int> (2, idx));
+            _invokableMethodHash[propInfo._setterName.toLatin1 ()]._candidates.append (QPair<int, int> (2, idx));
         }
 
         _propertyInfoHash[idx] = propInfo;
     }
 
+    for (auto it = _invokableMethodHash.begin (); it != _invokableMethodHash.end (); ++it)
+        compileSignatures (it.value ());
+
+    for (const QPair<QByteArray, int>& cached : cachedMethods)
+        setResultCache (cached.first, cached.second, 1024);
+
     _serviceInfo = createServiceInfo ();
 }
 
-static bool jsParameterCompare (const QJsonArray& parameters, const QJsonChannelServicePrivate::MethodInfo& info) {
+static bool jsParameterCompare (const int* types, int count, const QJsonChannelServicePrivate::MethodInfo& info) {
     int j = 0;
-    for (int i = 0; i < info._parameters.size () && j < parameters.size (); ++i) {
+    for (int i = 0; i < info._parameters.size () && j < count; ++i) {
         int jsType = info._parameters.at (i)._jsType;
-        if (jsType != QJsonValue::Undefined && jsType != parameters.at (j).type ()) {
+        if (jsType != QJsonValue::Undefined && jsType != types[j]) {
             if (!info._parameters.at (i)._out)
                 return false;
         } else {
@@ -356,14 +832,124 @@ static bool jsParameterCompare (const QJsonArray& parameters, const QJsonChannel
         }
     }
 
-    return (j == parameters.size ());
+    return (j == count);
+}
+
+// Signature of a positional call: the arity in the low 5 bits followed by 3 bits of JSON type per argument
+static const int maxSignatureArity = 19;
+static const int maxSignatures     = 1024;
+
+typedef QVarLengthArray<int, 8> QJsonChannelTypeSequence;
+
+static inline quint64 signatureKey (const int* types, int count) {
+    quint64 key = quint64 (count);
+    for (int i = 0; i < count; ++i)
+        key |= quint64 (types[i]) << (5 + 3 * i);
+    return key;
+}
+
+// JSON type of a CBOR argument as QCborValue::toJsonValue converts it, without converting
+static int jsonType (const QCborValue& value) {
+    switch (value.type ()) {
+    case QCborValue::Integer:
+    case QCborValue::Double:
+        return QJsonValue::Double;
+    case QCborValue::String:
+    case QCborValue::ByteArray:
+        return QJsonValue::String;
+    case QCborValue::False:
+    case QCborValue::True:
+        return QJsonValue::Bool;
+    case QCborValue::Null:
+        return QJsonValue::Null;
+    case QCborValue::Array:
+        return QJsonValue::Array;
+    case QCborValue::Map:
+        return QJsonValue::Object;
+    default:
+        break;
+    }
+
+    // an undefined value is stored as null by a JSON array and doesn't fit the 3 bits of a signature field
+    const QJsonValue::Type type = value.toJsonValue ().type ();
+    return type == QJsonValue::Undefined ? QJsonValue::Null : type;
+}
+
+// Collects the argument types sequences which may match the method (a superset), returns false if they can't be enumerated
+static bool collectSequences (const QJsonChannelServicePrivate::MethodInfo& info, int parameter, QJsonChannelTypeSequence& sequence,
+                              QList<QJsonChannelTypeSequence>& sequences) {
+    // the remaining parameters may be omitted
+    sequences.append (sequence);
+    if (parameter == info._parameters.size ())
+        return true;
+    if (sequence.size () == maxSignatureArity || sequences.size () >= maxSignatures)
+        return false;
+
+    const QJsonChannelServicePrivate::ParameterInfo& parameterInfo = info._parameters.at (parameter);
+    if (parameterInfo._jsType == QJsonValue::Undefined)
+        return false;
+
+    // an out parameter is skipped by an argument of another type
+    if (parameterInfo._out && !collectSequences (info, parameter + 1, sequence, sequences))
+        return false;
+
+    sequence.append (parameterInfo._jsType);
+    bool complete = collectSequences (info, parameter + 1, sequence, sequences);
+    sequence.removeLast ();
+    return complete;
 }
 
-static bool jsParameterCompare (const QJsonObject& parameters, const QJsonChannelServicePrivate::MethodInfo& info) {
+void QJsonChannelServicePrivate::compileSignatures (QJsonChannelService::Method& method) const {
+    QList<QJsonChannelTypeSequence> sequences;
+    bool                            exhaustive = true;
+    for (const QPair<int, int>& candidate : method._candidates) {
+        // getters and setters take any arguments
+        if (candidate.first != 0) {
+            exhaustive = false;
+            continue;
+        }
+
+        QJsonChannelTypeSequence sequence;
+        if (!collectSequences (*_methodInfoHash.constFind (candidate.second), 0, sequence, sequences))
+            exhaustive = false;
+    }
+
+    // the winner of a signature is the first candidate in the order of matching
+    for (const QJsonChannelTypeSequence& sequence : sequences) {
+        const quint64 key = signatureKey (sequence.constData (), sequence.size ());
+        if (method._signatures.contains (key))
+            continue;
+
+        for (int i = 0; i < method._candidates.size (); ++i) {
+            const QPair<int, int>& candidate = method._candidates.at (i);
+            if (candidate.first != 0 || jsParameterCompare (sequence.constData (), sequence.size (), *_methodInfoHash.constFind (candidate.second))) {
+                method._signatures.insert (key, i);
+                break;
+            }
+        }
+    }
+    method._exhaustive = exhaustive;
+}
+
+// Named arguments of a call sorted by name
+typedef QVarLengthArray<QPair<QString, QJsonValue>, 10> QJsonChannelNamedArguments;
+
+// Binds the named arguments to the parameters by merging the sorted names, the bound values are reused by the invocation
+static bool jsParameterCompare (const QJsonChannelNamedArguments& arguments, const QJsonChannelServicePrivate::MethodInfo& info,
+                                QVarLengthArray<QJsonValue, 10>& values) {
+    values.resize (info._parameters.size ());
+    const QPair<QString, QJsonValue>* argument = arguments.constBegin ();
+    const QPair<QString, QJsonValue>* end      = arguments.constEnd ();
+    for (const QPair<QString, int>& name : info._sortedNames) {
+        while (argument != end && argument->first < name.first)
+            ++argument;
+        values[name.second] = (argument != end && argument->first == name.first) ? argument->second : QJsonValue (QJsonValue::Undefined);
+    }
+
     for (int i = 0; i < info._parameters.size (); ++i) {
-        int        jsType = info._parameters.at (i)._jsType;
-        QJsonValue value  = parameters.value (info._parameters.at (i)._name);
-        if (value == QJsonValue::Undefined) {
+        int               jsType = info._parameters.at (i)._jsType;
+        const QJsonValue& value  = values[i];
+        if (value.isUndefined ()) {
             if (!info._parameters.at (i)._out)
                 return false;
         } else if (jsType == QJsonValue::Undefined) {
@@ -435,49 +1021,102 @@ QJsonValue QJsonChannelServicePrivate::convertReturnValue (QVariant& returnValue
     }
 }
 
-QJsonChannelMessage QJsonChannelServicePrivate::invokeMethod (int methodIndex, const QJsonChannelMessage& request) const {
-    const QJsonChannelServicePrivate::MethodInfo& info = _methodInfoHash[methodIndex];
+static QJsonChannelMessage createMethodResponse (const QJsonChannelMessage& request, bool hasReturn, const QJsonValue& returnValue, const QJsonArray& outs) {
+    if (outs.isEmpty ())
+        return request.createResponse (returnValue);
+
+    QJsonArray ret;
+    if (hasReturn)
+        ret.append (returnValue);
+    for (const QJsonValue& out : outs)
+        ret.append (out);
+    if (ret.size () > 1)
+        return request.createResponse (ret);
+    return request.createResponse (ret.first ());
+}
+
+QJsonChannelMessage QJsonChannelServicePrivate::invokeMethod (int methodIndex, const QJsonChannelMessage& request, QJsonChannelDeferred* deferred,
+                                                              const QJsonValue* boundArguments) const {
+    const QJsonChannelServicePrivate::MethodInfo& info = *_methodInfoHash.constFind (methodIndex);
 
-    QVariantList arguments;
-    arguments.reserve (info._parameters.size ());
+    // slot 0 is the return value, slot i + 1 is the parameter i
+    const int                   count = info._parameters.size () + 1;
+    QJsonChannelNativeArguments native (count);
+    QVarLengthArray<QVariant, 10> arguments (count);
 
     QMetaType::Type returnType = static_cast<QMetaType::Type> (info._returnType);
 
     QVarLengthArray<void*, 10> parameters;
-    QVariant                   returnValue = (returnType == QMetaType::Void) ? QVariant () : QVariant (returnType, Q_NULLPTR);
 
-    const QJsonValue& params = request.params ();
+    // messages decoded from CBOR carry QByteArray arguments and results as byte strings
+    const bool       binary       = request.isCbor ();
+    const QCborValue binaryParams = binary ? request.cborParams () : QCborValue ();
+    const QCborArray binaryArray  = binary && !boundArguments ? binaryParams.toArray () : QCborArray ();
 
-    bool usingNamedParameters = params.isObject ();
+    // named arguments are bound by the overload matching, positional ones are taken from the array, CBOR ones are converted one by one
+    const QJsonArray positional = boundArguments || binary ? QJsonArray () : request.params ().toArray ();
 
-    if (returnType == QMetaType::QVariant)
-        parameters.append (&returnValue);
-    else
-        parameters.append (returnValue.data ());
+    // nobody gets a notification result, the slot gets no return storage and nothing is converted
+    const bool notification = request.type () == QJsonChannelMessage::Notification;
+
+    if (notification) {
+        parameters.append (nullptr);
+    } else if (native.construct (0, info._returnMarshaler, QJsonValue (QJsonValue::Undefined))) {
+        parameters.append (native.data (0));
+    } else {
+        QVariant& returnValue = arguments[0];
+        if (returnType != QMetaType::Void)
+            returnValue = QVariant (returnType, Q_NULLPTR);
+
+        if (returnType == QMetaType::QVariant)
+            parameters.append (&returnValue);
+        else
+            parameters.append (returnValue.data ());
+    }
 
     for (int i = 0; i < info._parameters.size (); ++i) {
         const QJsonChannelServicePrivate::ParameterInfo& parameterInfo = info._parameters.at (i);
-        QJsonValue incomingArgument = usingNamedParameters ? params.toObject ().value (parameterInfo._name) : params.toArray ().at (i);
 
-        QVariant argument = convertArgument (incomingArgument, parameterInfo._type);
+        if (binary && parameterInfo._type == QMetaType::QByteArray) {
+            const QCborValue bytes = binaryParams.isMap () ? binaryParams.toMap ().value (parameterInfo._name) : binaryArray.at (i);
+            if (bytes.isByteArray ()) {
+                QVariant& argument = arguments[i + 1];
+                argument           = QVariant (bytes.toByteArray ());
+                parameters.append (argument.data ());
+                continue;
+            }
+        }
+
+        QJsonValue incomingArgument;
+        if (boundArguments)
+            incomingArgument = boundArguments[i];
+        else if (binary)
+            incomingArgument = i < binaryArray.size () ? binaryArray.at (i).toJsonValue () : QJsonValue (QJsonValue::Undefined);
+        else
+            incomingArgument = positional.at (i);
+
+        if (native.construct (i + 1, parameterInfo._marshaler, incomingArgument)) {
+            parameters.append (native.data (i + 1));
+            continue;
+        }
+
+        QVariant& argument = arguments[i + 1];
+        argument           = convertArgument (incomingArgument, parameterInfo._type);
         if (!argument.isValid ()) {
             QString message = incomingArgument.isUndefined () ? QString ("failed to construct default object for '%1'").arg (parameterInfo._name)
                                                               : QString ("failed to convert from JSON for '%1'").arg (parameterInfo._name);
             return request.createErrorResponse (QJsonChannel::InvalidParams, message);
         }
 
-        arguments.push_back (argument);
         if (parameterInfo._type == QMetaType::QVariant)
-            parameters.append (static_cast<void*> (&arguments.last ()));
+            parameters.append (static_cast<void*> (&argument));
         else
-            parameters.append (const_cast<void*> (arguments.last ().constData ()));
+            parameters.append (const_cast<void*> (argument.constData ()));
     }
 
     bool success = false;
-    if (_isServiceObjThreadSafe) {
-        success = _serviceObj->qt_metacall (QMetaObject::InvokeMetaMethod, methodIndex, parameters.data ()) < 0;
-    } else {
-        QMutexLocker lock (&_serviceMutex);
+    {
+        QJsonChannelServiceLocker lock (this, info._readOnly);
         success = _serviceObj->qt_metacall (QMetaObject::InvokeMetaMethod, methodIndex, parameters.data ()) < 0;
     }
 
@@ -486,19 +1125,41 @@ QJsonChannelMessage QJsonChannelServicePrivate::invokeMethod (int methodIndex, c
         return request.createErrorResponse (QJsonChannel::InvalidRequest, message);
     }
 
+    if (notification)
+        return QJsonChannelMessage ();
+
+    auto convertSlot = [&native, &arguments] (int index) {
+        return native.isNative (index) ? native.toJson (index) : QJsonChannelServicePrivate::convertReturnValue (arguments[index]);
+    };
+
+    QJsonArray outs;
     if (info._hasOut) {
-        QJsonArray ret;
-        if (info._returnType != QMetaType::Void)
-            ret.append (QJsonChannelServicePrivate::convertReturnValue (returnValue));
         for (int i = 0; i < info._parameters.size (); ++i)
             if (info._parameters.at (i)._out)
-                ret.append (QJsonChannelServicePrivate::convertReturnValue (arguments[i]));
-        if (ret.size () > 1)
-            return request.createResponse (ret);
-        return request.createResponse (ret.first ());
+                outs.append (convertSlot (i + 1));
     }
 
-    return request.createResponse (QJsonChannelServicePrivate::convertReturnValue (returnValue));
+    bool hasReturn = (info._returnType != QMetaType::Void);
+    if (info._futureAdapter) {
+        const void* future = arguments[0].constData ();
+        if (!deferred) {
+            QVariant result = info._futureAdapter->wait (future);
+            return createMethodResponse (request, hasReturn, QJsonChannelServicePrivate::convertReturnValue (result), outs);
+        }
+
+        deferred->_pending                = true;
+        QJsonChannelCompletion completion = deferred->_completion;
+        info._futureAdapter->then (future, [request, completion, hasReturn, outs] (const QVariant& value) {
+            QVariant result = value;
+            completion (createMethodResponse (request, hasReturn, QJsonChannelServicePrivate::convertReturnValue (result), outs));
+        });
+        return QJsonChannelMessage ();
+    }
+
+    if (binary && info._returnType == QMetaType::QByteArray && outs.isEmpty ())
+        return request.createCborResponse (QCborValue (arguments[0].toByteArray ()));
+
+    return createMethodResponse (request, hasReturn, convertSlot (0), outs);
 }
 
 // getter
@@ -512,13 +1173,15 @@ QJsonChannelMessage QJsonChannelServicePrivate::callGetter (int propertyIndex, c
         return request.createErrorResponse (QJsonChannel::InvalidRequest, "getter shouldn't have parameters");
     }
 
-    const QJsonChannelServicePrivate::PropInfo& prop = _propertyInfoHash[propertyIndex];
+    // reading has no effect nobody would see
+    if (request.type () == QJsonChannelMessage::Notification)
+        return QJsonChannelMessage ();
+
+    const QJsonChannelServicePrivate::PropInfo& prop = *_propertyInfoHash.constFind (propertyIndex);
 
     QVariant returnValue;
-    if (_isServiceObjThreadSafe) {
-        returnValue = prop._prop.read (_serviceObj.data ());
-    } else {
-        QMutexLocker lock (&_serviceMutex);
+    {
+        QJsonChannelServiceLocker lock (this, true);
         returnValue = prop._prop.read (_serviceObj.data ());
     }
 
@@ -535,75 +1198,247 @@ QJsonChannelMessage QJsonChannelServicePrivate::callSetter (int propertyIndex, c
         return request.createErrorResponse (QJsonChannel::InvalidRequest, "setter should have one parameter");
     }
 
-    const QJsonChannelServicePrivate::PropInfo& prop = _propertyInfoHash[propertyIndex];
+    const QJsonChannelServicePrivate::PropInfo& prop = *_propertyInfoHash.constFind (propertyIndex);
 
     QVariant argument = convertArgument (arr[0], prop._type);
 
-    if (_isServiceObjThreadSafe) {
-        prop._prop.write (_serviceObj.data (), argument);
-    } else {
-        QMutexLocker lock (&_serviceMutex);
+    {
+        QJsonChannelServiceLocker lock (this, false);
         prop._prop.write (_serviceObj.data (), argument);
     }
 
+    // the property may have no NOTIFY signal
+    const auto cache = _propertyCaches.constFind (propertyIndex);
+    if (cache != _propertyCaches.constEnd ())
+        cache.value ()->clear ();
+
+    if (request.type () == QJsonChannelMessage::Notification)
+        return QJsonChannelMessage ();
+
     // no return value
     QVariant returnValue;
     return request.createResponse (QJsonChannelServicePrivate::convertReturnValue (returnValue));
 }
 
+QJsonChannelMessage QJsonChannelServicePrivate::invokeTyped (int typedIndex, const QJsonChannelMessage& request) const {
+    const TypedMethodInfo&         info   = _typedMethodInfos.at (typedIndex);
+    const QJsonChannelTypedMethod& method = info._method;
+    const QJsonValue&              params = request.params ();
+
+    QVarLengthArray<QJsonValue, 10> arguments (method.arity);
+    if (params.isObject ()) {
+        const QJsonObject object = params.toObject ();
+        if (info._parameterNames.isEmpty () || object.size () != method.arity)
+            return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+
+        for (int i = 0; i < method.arity; ++i) {
+            const auto it = object.constFind (info._parameterNames.at (i));
+            if (it == object.constEnd ())
+                return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+            arguments[i] = it.value ();
+        }
+    } else {
+        const QJsonArray array = params.toArray ();
+        if (array.size () != method.arity)
+            return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+
+        for (int i = 0; i < method.arity; ++i)
+            arguments[i] = array.at (i);
+    }
+
+    QJsonValue result;
+    bool       success = false;
+    {
+        QJsonChannelServiceLocker lock (this, method.readOnly);
+        success = method.invoke (_serviceObj.data (), arguments.constData (), &result);
+    }
+
+    if (!success)
+        return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+    if (request.type () == QJsonChannelMessage::Notification)
+        return QJsonChannelMessage ();
+    return request.createResponse (result);
+}
+
 static inline QByteArray methodName (const QJsonChannelMessage& request) {
-    const QString& methodPath (request.method ());
-    return methodPath.midRef (methodPath.lastIndexOf ('.') + 1).toLatin1 ();
+    // refers to the request data, valid while the request is alive
+    const QByteArray& methodPath (request.methodPath ());
+    int               start = methodPath.lastIndexOf ('.') + 1;
+    return QByteArray::fromRawData (methodPath.constData () + start, methodPath.size () - start);
+}
+
+QHash<QByteArray, const QJsonChannelService::Method*> QJsonChannelService::methods () const {
+    const QJsonChannelServicePrivate* d = d_ptr.get ();
+    d->_published.storeRelease (1);
+
+    QHash<QByteArray, const Method*> methods;
+    methods.reserve (d->_invokableMethodHash.size ());
+    for (auto it = d->_invokableMethodHash.constBegin (); it != d->_invokableMethodHash.constEnd (); ++it)
+        methods.insert (it.key (), &it.value ());
+    return methods;
 }
 
 QJsonChannelMessage QJsonChannelService::dispatch (const QJsonChannelMessage& request) const {
     const QJsonChannelServicePrivate* d = d_ptr.get ();
     if (request.type () != QJsonChannelMessage::Request && request.type () != QJsonChannelMessage::Notification) {
-        return request.createErrorResponse (QJsonChannel::InvalidRequest, "invalid request");
+        return request.createStandardErrorResponse (QJsonChannel::InvalidRequest);
     }
 
-    const QByteArray& method (methodName (request));
-    if (!d->_invokableMethodHash.contains (method)) {
-        return request.createErrorResponse (QJsonChannel::MethodNotFound, "invalid method called");
+    const auto it = d->_invokableMethodHash.constFind (methodName (request));
+    if (it == d->_invokableMethodHash.constEnd ()) {
+        return request.createStandardErrorResponse (QJsonChannel::MethodNotFound);
     }
 
-    const QList<QPair<int, int>>& indexes = d->_invokableMethodHash.value (method);
-    const QJsonValue&             params  = request.params ();
+    return dispatch (request, &it.value ());
+}
+
+QJsonChannelMessage QJsonChannelService::dispatch (const QJsonChannelMessage& request, const Method* method) const {
+    const QJsonChannelServicePrivate* d = d_ptr.get ();
+    if (!d->_executor || d->_executor->isCurrent ())
+        return d->dispatch (request, method, nullptr);
+
+    // a pool thread waiting here drains the executor by itself, the pool can't run out of threads for the drain
+    QJsonChannelMessage response;
+    d->_executor->invoke ([d, &request, method, &response] () { response = d->dispatch (request, method, nullptr); });
+    return response;
+}
 
-    bool usingNamedParameters = params.isObject ();
+void QJsonChannelService::dispatch (const QJsonChannelMessage& request, const Method* method, const QJsonChannelCompletion& completion) const {
+    QSharedPointer<const QJsonChannelServicePrivate> d = d_ptr;
+    if (!d->_executor || d->_executor->isCurrent ()) {
+        d->dispatch (request, method, completion);
+        return;
+    }
+
+    d->_executor->post ([d, request, method, completion] () { d->dispatch (request, method, completion); },
+                        [request, completion] () { completion (request.createStandardErrorResponse (QJsonChannel::InternalError)); });
+}
+
+void QJsonChannelServicePrivate::dispatch (const QJsonChannelMessage& request, const QJsonChannelService::Method* method,
+                                           const QJsonChannelCompletion& completion) const {
+    QJsonChannelDeferred deferred;
+    deferred._completion         = completion;
+    QJsonChannelMessage response = dispatch (request, method, &deferred);
+    if (!deferred._pending)
+        completion (response);
+}
+
+QJsonChannelMessage QJsonChannelServicePrivate::dispatch (const QJsonChannelMessage& request, const QJsonChannelService::Method* method,
+                                                          QJsonChannelDeferred* deferred) const {
+    // CBOR results may carry byte strings, notifications have no results
+    if (!method->_cache || request.type () != QJsonChannelMessage::Request || request.isCbor ())
+        return dispatchMethod (request, method, deferred);
+
+    // object parameters are serialized with sorted keys
+    const QJsonValue params = request.params ();
+    QByteArray       key;
+    if (params.isArray ())
+        key = QJsonDocument (params.toArray ()).toJson (QJsonDocument::Compact);
+    else if (params.isObject ())
+        key = QJsonDocument (params.toObject ()).toJson (QJsonDocument::Compact);
+
+    QByteArray result;
+    quint64    generation = 0;
+    if (method->_cache->lookup (key, _clock.elapsed (), &result, &generation))
+        return request.createSerializedResponse (result);
+
+    QJsonChannelMessage response = dispatchMethod (request, method, deferred);
+    if (response.type () == QJsonChannelMessage::Response && !(deferred && deferred->_pending))
+        method->_cache->insert (key, response.resultJson (), _clock.elapsed (), generation);
+    return response;
+}
+
+QJsonChannelMessage QJsonChannelServicePrivate::dispatchMethod (const QJsonChannelMessage& request, const QJsonChannelService::Method* method,
+                                                                QJsonChannelDeferred* deferred) const {
+    const QJsonChannelServicePrivate* d = this;
+    if (request.type () != QJsonChannelMessage::Request && request.type () != QJsonChannelMessage::Notification) {
+        return request.createStandardErrorResponse (QJsonChannel::InvalidRequest);
+    }
+
+    if (method->_typed >= 0)
+        return d->invokeTyped (method->_typed, request);
+
+    const QList<QPair<int, int>>& indexes = method->_candidates;
+
+    // CBOR params are matched by their types, the byte strings aren't converted to base64 text
+    const bool       binary       = request.isCbor ();
+    const QCborValue binaryParams = binary ? request.cborParams () : QCborValue ();
+    const QJsonValue params       = binary ? QJsonValue () : request.params ();
+
+    bool usingNamedParameters = binary ? binaryParams.isMap () : params.isObject ();
+
+    if (!usingNamedParameters) {
+        QVarLengthArray<int, 16> types;
+        if (binary) {
+            const QCborArray arguments = binaryParams.toArray ();
+            types.resize (arguments.size ());
+            for (int i = 0; i < arguments.size (); ++i)
+                types[i] = jsonType (arguments.at (i));
+        } else {
+            const QJsonArray arguments = params.toArray ();
+            types.resize (arguments.size ());
+            for (int i = 0; i < arguments.size (); ++i)
+                types[i] = arguments.at (i).type ();
+        }
+
+        // the precompiled signatures resolve the call in one pass over the arguments
+        if (types.size () <= maxSignatureArity) {
+            const auto it = method->_signatures.constFind (signatureKey (types.constData (), types.size ()));
+            if (it != method->_signatures.constEnd ())
+                return d->invokeCandidate (indexes.at (it.value ()), request, deferred);
+            if (method->_exhaustive)
+                return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+        }
+
+        // iterate over candidates
+        for (const QPair<int, int>& methodInfo : indexes) {
+            if (methodInfo.first != 0 || jsParameterCompare (types.constData (), types.size (), *d->_methodInfoHash.constFind (methodInfo.second)))
+                return d->invokeCandidate (methodInfo, request, deferred);
+        }
+
+        return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+    }
+
+    // one pass over the object, the candidates merge the sorted arguments with their sorted parameter names
+    const QJsonObject          object = binary ? request.params ().toObject () : params.toObject ();
+    QJsonChannelNamedArguments arguments;
+    arguments.reserve (object.size ());
+    for (auto it = object.constBegin (); it != object.constEnd (); ++it)
+        arguments.append (qMakePair (it.key (), it.value ()));
+    std::sort (arguments.begin (), arguments.end (),
+               [] (const QPair<QString, QJsonValue>& left, const QPair<QString, QJsonValue>& right) { return left.first < right.first; });
+
+    QVarLengthArray<QJsonValue, 10> values;
 
     // iterate over candidates
     for (const QPair<int, int>& methodInfo : indexes) {
         // method call
         if (methodInfo.first == 0) {
-            int methodIndex = methodInfo.second;
-
-            const QJsonChannelServicePrivate::MethodInfo& info = d->_methodInfoHash[methodIndex];
-            bool methodMatch = usingNamedParameters ? jsParameterCompare (params.toObject (), info) : jsParameterCompare (params.toArray (), info);
-
-            if (methodMatch) {
-                return d->invokeMethod (methodIndex, request);
-            }
+            if (jsParameterCompare (arguments, *d->_methodInfoHash.constFind (methodInfo.second), values))
+                return d->invokeMethod (methodInfo.second, request, deferred, values.constData ());
         }
 
         // getter
         if (methodInfo.first == 1) {
-            if (usingNamedParameters) {
-                return request.createErrorResponse (QJsonChannel::InvalidRequest, "getters are supporting only array-styled requests");
-            }
-            int propertyIndex = methodInfo.second;
-
-            return d->callGetter (propertyIndex, request);
+            return request.createErrorResponse (QJsonChannel::InvalidRequest, "getters are supporting only array-styled requests");
         }
         // setter
         if (methodInfo.first == 2) {
-            if (usingNamedParameters) {
-                return request.createErrorResponse (QJsonChannel::InvalidRequest, "setters are supporting only array-styled requests");
-            }
-            int propertyIndex = methodInfo.second;
-            return d->callSetter (propertyIndex, request);
+            return request.createErrorResponse (QJsonChannel::InvalidRequest, "setters are supporting only array-styled requests");
         }
     }
 
-    return request.createErrorResponse (QJsonChannel::InvalidParams, "invalid parameters");
+    return request.createStandardErrorResponse (QJsonChannel::InvalidParams);
+}
+
+QJsonChannelMessage QJsonChannelServicePrivate::invokeCandidate (const QPair<int, int>& candidate, const QJsonChannelMessage& request,
+                                                                 QJsonChannelDeferred* deferred) const {
+    switch (candidate.first) {
+    case 0:
+        return invokeMethod (candidate.second, request, deferred);
+    case 1:
+        return callGetter (candidate.second, request);
+    default:
+        return callSetter (candidate.second, request);
+    }
 }
@@ -2,11 +2,16 @@
 
 #include <QObject>
 #include <QByteArray>
+#include <QHash>
+#include <QList>
 #include <QSharedPointer>
+#include <QStringList>
 
 #include "QJsonChannelMessage.h"
+#include "QJsonChannelTypedMethod.h"
 
 class QJsonChannelServicePrivate;
+class QThreadPool;
 
 /**
  * @brief Service wrapper over QOblect is responsible for QObjects methods ivocation according to JSON-RPC requests messages.
@@ -14,6 +19,25 @@ class QJsonChannelServicePrivate;
  */
 class QJSONCHANNELCORE_EXPORT QJsonChannelService {
 public:
+    /**
+     * @brief Invokable method of the service (all its overloads, getter or setter)
+     * 
+     */
+    struct Method;
+
+    /**
+     * @brief Serialization of the invocations of a service object which is not thread safe
+     * 
+     */
+    enum ExecutorMode {
+        //! Invocations are run by the calling threads under the service mutex
+        NoExecutor,
+        //! Invocations are queued to the service executor and run one by one by a thread pool worker
+        PoolExecutor,
+        //! Invocations are queued to the service executor and run one by one by the service object thread, the thread should run an event loop
+        ObjectThreadExecutor
+    };
+
     /**
      * @brief Construct a new QJsonChannelService object
      * 
@@ -41,6 +65,116 @@ public:
      */
     const QByteArray& serviceName () const;
 
+    /**
+     * @brief Returns true if the service object was declared thread safe
+     * 
+     * @return true The service object can be invoked concurrently without locking
+     * @return false The service object invocations are serialized
+     */
+    bool isThreadSafe () const;
+
+    /**
+     * @brief Serializes the invocations of a service object which is not thread safe by its own executor instead of the service mutex.
+     * Asynchronous dispatch only queues the request, so a busy service doesn't occupy the callers threads.
+     * Has no effect on thread safe services. The executor is fixed once the methods are published to a repository.
+     * 
+     * @param mode Executor mode
+     * @param pool Thread pool of PoolExecutor, QThreadPool::globalInstance () if nullptr
+     * @return true The executor is set
+     * @return false The service is thread safe or already added to a repository
+     */
+    bool setExecutor (ExecutorMode mode, QThreadPool* pool = nullptr);
+
+    /**
+     * @brief Returns the executor mode of the service
+     * 
+     * @return ExecutorMode 
+     */
+    ExecutorMode executorMode () const;
+
+    /**
+     * @brief Guards a service object which is not thread safe by a read/write lock instead of the service mutex.
+     * Property getters and read-only methods share the lock, setters and other methods take it exclusively.
+     * Methods are read-only if they are listed by Q_CLASSINFO ("QJsonChannelReadOnly", "method1,method2") 
+     * or by setReadOnlyMethods. The locking is fixed once the methods are published to a repository.
+     * 
+     * @param enabled Use the read/write lock
+     * @return true The locking is set
+     * @return false The service is already added to a repository
+     */
+    bool setReadWriteLocking (bool enabled);
+
+    /**
+     * @brief Returns true if the service object is guarded by a read/write lock
+     * 
+     * @return true Getters and read-only methods are invoked concurrently
+     * @return false All invocations are serialized
+     */
+    bool readWriteLocking () const;
+
+    /**
+     * @brief Marks methods which don't modify the service object, all overloads of a method are marked.
+     * The read-only methods are fixed once the methods are published to a repository.
+     * 
+     * @param methods Method names
+     * @return true The methods are marked
+     * @return false The service is already added to a repository
+     */
+    bool setReadOnlyMethods (const QList<QByteArray>& methods);
+
+    /**
+     * @brief Caches the serialized results of a method or a property getter by its parameters.
+     * Methods are cached as well if they are listed by Q_CLASSINFO ("QJsonChannelCached", "method1:ttl1,method2:ttl2").
+     * A getter cache is cleared by the property NOTIFY signal and by the property setter.
+     * Results delivered by QFuture are not cached. The caches are fixed once the methods are published to a repository.
+     * 
+     * @param method Method or getter name
+     * @param ttl Time to live of the cached results in milliseconds, the cache is disabled if it's 0
+     * @param maxEntries Maximum number of cached parameter sets
+     * @return true The cache is set
+     * @return false The method is not found or the service is already added to a repository
+     */
+    bool setResultCache (const QByteArray& method, int ttl, int maxEntries = 1024);
+
+    /**
+     * @brief Clears the cached results of a method
+     * 
+     * @param method Method or getter name
+     */
+    void invalidateResultCache (const QByteArray& method);
+
+    /**
+     * @brief Registers a method invoked by a compile-time generated invoker instead of the QMetaObject reflection.
+     * The method replaces a reflected method with the same name. Its arguments are converted directly from JSON,
+     * so a call should pass exactly one argument per parameter of a matching JSON type.
+     * The methods are fixed once they are published to a repository, a later registration is rejected.
+     * 
+     * @param name Method name
+     * @param method Typed invoker, see qJsonChannelTypedMethod
+     * @param parameterNames Parameter names for the calls with named parameters, such calls are rejected if it's empty
+     * @return true The method was registered
+     * @return false The service object is not an instance of the method class, the number of names doesn't match
+     * or the service is already added to a repository
+     */
+    bool registerMethod (const QByteArray& name, const QJsonChannelTypedMethod& method, const QStringList& parameterNames = QStringList ());
+
+#if defined(__cpp_nontype_template_parameter_auto)
+    /**
+     * @brief Registers a member function of the service object class by a typed invoker, 
+     * service->registerMethod<&Calculator::add> ("add", {"a", "b"})
+     * 
+     * @tparam Function Pointer to the member function, its parameters and return value should have QJsonChannelJsonTraits
+     * @param name Method name
+     * @param parameterNames Parameter names for the calls with named parameters
+     * @return true The method was registered
+     * @return false The service object is not an instance of the method class or the service is already added to a repository
+     */
+    template <auto Function>
+    bool registerMethod (const QByteArray& name, const QStringList& parameterNames = QStringList ()) {
+        return registerMethod (name, qJsonChannelTypedMethod<Function> (), parameterNames);
+    }
+#endif
+
     /**
      * @brief Returns JSON Document contains JSON Schema Service Descriptor 
      * (https://jsonrpc.org/historical/json-schema-service-descriptor.html)
@@ -57,11 +191,39 @@ public:
      */
     QJsonChannelMessage dispatch (const QJsonChannelMessage& request) const;
 
+    /**
+     * @brief Returns invokable methods of the service by method name. The methods are valid during the service lifetime,
+     * the service methods can't be registered or cached anymore once they are returned.
+     * 
+     * @return QHash<QByteArray, const Method*> 
+     */
+    QHash<QByteArray, const Method*> methods () const;
+
+    /**
+     * @brief Process a JSON-RPC message with already resolved method.
+     * 
+     * @param request JSON-RPC message
+     * @param method Method of the service which is requested by the message
+     * @return QJsonChannelMessage JSON-RPC response message
+     */
+    QJsonChannelMessage dispatch (const QJsonChannelMessage& request, const Method* method) const;
+
+    /**
+     * @brief Process a JSON-RPC message asynchronously. The method is invoked on the calling thread or queued to the service executor, 
+     * if it returns a QFuture (see qJsonChannelRegisterFuture) the completion is called when the future is finished.
+     * 
+     * @param request JSON-RPC message
+     * @param method Method of the service which is requested by the message
+     * @param completion Receives JSON-RPC response message
+     */
+    void dispatch (const QJsonChannelMessage& request, const Method* method, const QJsonChannelCompletion& completion) const;
+
 private:
     Q_DISABLE_COPY (QJsonChannelService)
     Q_DECLARE_PRIVATE (QJsonChannelService)
 
 #if !defined(USE_QT_PRIVATE_HEADERS)
-    QScopedPointer<QJsonChannelServicePrivate> d_ptr;
+    // shared with the queued dispatches
+    QSharedPointer<QJsonChannelServicePrivate> d_ptr;
 #endif
 };
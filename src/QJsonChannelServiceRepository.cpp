@@ -2,25 +2,334 @@
 #include <QMetaObject>
 #include <QMetaClassInfo>
 #include <QDebug>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QCryptographicHash>
+#include <QFutureInterface>
+#include <QJsonDocument>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
 
+#include "QJsonChannelCodec.h"
+#include "QJsonChannelMetrics.h"
 #include "QJsonChannelService.h"
 #include "QJsonChannelServiceRepository.h"
 
+typedef QHash<QByteArray, QSharedPointer<QJsonChannelService>> QJsonChannelServiceHash;
+
+// Service and its method resolved by the full method path
+struct QJsonChannelDispatchEntry {
+    QSharedPointer<QJsonChannelService> _service;
+    const QJsonChannelService::Method*  _method = nullptr;
+};
+
+// Immutable set of the registered services. Writers publish a modified copy, readers never lock.
+struct QJsonChannelServiceSnapshot {
+    void insertMethods (const QByteArray& serviceName, const QSharedPointer<QJsonChannelService>& service);
+    void removeMethods (const QSharedPointer<QJsonChannelService>& service);
+    void insertDiscovery (const QByteArray& serviceName, const QSharedPointer<QJsonChannelService>& service);
+    void removeDiscovery (const QByteArray& serviceName);
+    void updateDiscovery ();
+
+    QJsonChannelServiceHash                      _services;
+    QHash<QByteArray, QJsonChannelDispatchEntry> _dispatchTable; // "service.method" -> entry
+
+    // discovery document serialized once per change, services are kept in the QJsonObject key order
+    QMap<QByteArray, QByteArray> _discoveryMembers; // service name -> "name":{service info}
+    QByteArray                   _discovery;        // {"name":{service info},...}
+    QByteArray                   _discoveryTag;     // hash of the discovery document
+    QByteArray                   _taggedDiscovery;  // {"services":{...},"tag":"..."}
+    QByteArray                   _notModified;      // {"notModified":true,"tag":"..."}
+};
+
+void QJsonChannelServiceSnapshot::insertMethods (const QByteArray& serviceName, const QSharedPointer<QJsonChannelService>& service) {
+    const QHash<QByteArray, const QJsonChannelService::Method*>& methods = service->methods ();
+    for (auto it = methods.constBegin (); it != methods.constEnd (); ++it) {
+        QJsonChannelDispatchEntry& entry = _dispatchTable[serviceName + '.' + it.key ()];
+        entry._service                   = service;
+        entry._method                    = it.value ();
+    }
+}
+
+void QJsonChannelServiceSnapshot::removeMethods (const QSharedPointer<QJsonChannelService>& service) {
+    for (auto it = _dispatchTable.begin (); it != _dispatchTable.end ();) {
+        if (it.value ()._service == service)
+            it = _dispatchTable.erase (it);
+        else
+            ++it;
+    }
+}
+
+void QJsonChannelServiceSnapshot::insertDiscovery (const QByteArray& serviceName, const QSharedPointer<QJsonChannelService>& service) {
+    QJsonObject member;
+    member.insert (QString::fromUtf8 (serviceName), service->serviceInfo ());
+    QByteArray json = QJsonDocument (member).toJson (QJsonDocument::Compact);
+
+    // strip the braces of the single member object
+    _discoveryMembers.insert (serviceName, json.mid (1, json.size () - 2));
+    updateDiscovery ();
+}
+
+void QJsonChannelServiceSnapshot::removeDiscovery (const QByteArray& serviceName) {
+    _discoveryMembers.remove (serviceName);
+    updateDiscovery ();
+}
+
+void QJsonChannelServiceSnapshot::updateDiscovery () {
+    int size = 2;
+    for (const QByteArray& member : _discoveryMembers)
+        size += member.size () + 1;
+
+    _discovery.clear ();
+    _discovery.reserve (size);
+    _discovery += '{';
+    for (auto it = _discoveryMembers.constBegin (); it != _discoveryMembers.constEnd (); ++it) {
+        if (it != _discoveryMembers.constBegin ())
+            _discovery += ',';
+        _discovery += it.value ();
+    }
+    _discovery += '}';
+
+    _discoveryTag    = QCryptographicHash::hash (_discovery, QCryptographicHash::Sha1).toHex ();
+    _taggedDiscovery = "{\"services\":" + _discovery + ",\"tag\":\"" + _discoveryTag + "\"}";
+    _notModified     = "{\"notModified\":true,\"tag\":\"" + _discoveryTag + "\"}";
+}
+
 class QJsonChannelServiceRepositoryPrivate {
 public:
-    QJsonObject servicesInfo () const;
+    QJsonChannelServiceRepositoryPrivate ();
+    ~QJsonChannelServiceRepositoryPrivate ();
+
+    // Pins the current snapshot. A retired snapshot is released only after every guard of its epoch is gone.
+    class ReadGuard {
+    public:
+        explicit ReadGuard (const QJsonChannelServiceRepositoryPrivate* d);
+        ~ReadGuard ();
+
+        const QJsonChannelServiceSnapshot* operator-> () const {
+            return _snapshot;
+        }
+
+    private:
+        Q_DISABLE_COPY (ReadGuard)
 
-    QHash<QByteArray, QSharedPointer<QJsonChannelService>> _services;
+        const QJsonChannelServiceRepositoryPrivate* _d;
+        const QJsonChannelServiceSnapshot*          _snapshot;
+        int                                         _epoch;
+    };
+
+    QJsonChannelMessage                 discover (const QJsonChannelMessage& message) const;
+    QSharedPointer<QJsonChannelService> findService (const QByteArray& serviceName) const;
+    bool                                resolve (const QByteArray& methodPath, QJsonChannelDispatchEntry* entry) const;
+    bool                                route (const QJsonChannelMessage& message, QJsonChannelDispatchEntry* entry, QJsonChannelMessage* response) const;
+    QThreadPool*                        threadPool () const;
+
+    // should be called with _writeMutex locked
+    void publish (QJsonChannelServiceSnapshot* snapshot);
+
+    QAtomicPointer<QJsonChannelServiceSnapshot> _snapshot;
+    mutable QAtomicInt                          _epoch;
+    mutable QAtomicInt                          _readers[2];
+    QMutex                                      _writeMutex;
+    QAtomicPointer<QThreadPool>                 _threadPool;
+
+    // fire-and-forget notifications, queued counts the posted notifications which are not processed yet
+    QAtomicInt                      _notificationLimit = 1024;
+    mutable QAtomicInt              _notificationsQueued;
+    mutable QAtomicInt              _notificationsPeak;
+    mutable QAtomicInteger<quint64> _notificationsPosted;
+    mutable QAtomicInteger<quint64> _notificationsProcessed;
+    mutable QAtomicInteger<quint64> _notificationsRejected;
 };
 
-QJsonObject QJsonChannelServiceRepositoryPrivate::servicesInfo () const {
-    QJsonObject objectInfos;
-    const auto  end = _services.constEnd ();
-    for (auto it = _services.constBegin (); it != end; ++it) {
-        const QJsonObject& info = it.value ()->serviceInfo ();
-        objectInfos[it.key ()]  = info;
+QJsonChannelServiceRepositoryPrivate::QJsonChannelServiceRepositoryPrivate () : _snapshot (new QJsonChannelServiceSnapshot) {
+    _snapshot.loadAcquire ()->updateDiscovery ();
+}
+
+QJsonChannelServiceRepositoryPrivate::~QJsonChannelServiceRepositoryPrivate () {
+    delete _snapshot.loadAcquire ();
+}
+
+QJsonChannelServiceRepositoryPrivate::ReadGuard::ReadGuard (const QJsonChannelServiceRepositoryPrivate* d) : _d (d) {
+    // the epoch is re-read after the registration: a writer that flipped it in between might not have seen us
+    forever {
+        _epoch = _d->_epoch.fetchAndAddOrdered (0);
+        _d->_readers[_epoch & 1].ref ();
+        if (_d->_epoch.fetchAndAddOrdered (0) == _epoch)
+            break;
+        _d->_readers[_epoch & 1].deref ();
     }
-    return objectInfos;
+    _snapshot = _d->_snapshot.loadAcquire ();
+}
+
+QJsonChannelServiceRepositoryPrivate::ReadGuard::~ReadGuard () {
+    _d->_readers[_epoch & 1].deref ();
+}
+
+void QJsonChannelServiceRepositoryPrivate::publish (QJsonChannelServiceSnapshot* snapshot) {
+    QJsonChannelServiceSnapshot* retired = _snapshot.fetchAndStoreOrdered (snapshot);
+
+    // new readers enter the next epoch and see the new snapshot, wait for the readers of the previous one
+    int epoch = _epoch.fetchAndAddOrdered (1);
+    while (_readers[epoch & 1].fetchAndAddOrdered (0) != 0)
+        QThread::yieldCurrentThread ();
+
+    // in-flight dispatches keep their services alive by their own references
+    delete retired;
+}
+
+QSharedPointer<QJsonChannelService> QJsonChannelServiceRepositoryPrivate::findService (const QByteArray& serviceName) const {
+    ReadGuard  snapshot (this);
+    const auto it = snapshot->_services.constFind (serviceName);
+    if (it == snapshot->_services.constEnd ())
+        return QSharedPointer<QJsonChannelService> ();
+    return it.value ();
+}
+
+bool QJsonChannelServiceRepositoryPrivate::resolve (const QByteArray& methodPath, QJsonChannelDispatchEntry* entry) const {
+    ReadGuard  snapshot (this);
+    const auto it = snapshot->_dispatchTable.constFind (methodPath);
+    if (it == snapshot->_dispatchTable.constEnd ())
+        return false;
+    *entry = it.value ();
+    return true;
+}
+
+// Routes a message to the method of a service. Messages which are not dispatched to a service get the response immediately.
+bool QJsonChannelServiceRepositoryPrivate::route (const QJsonChannelMessage& message, QJsonChannelDispatchEntry* entry, QJsonChannelMessage* response) const {
+    switch (message.type ()) {
+    case QJsonChannelMessage::Discrovery: {
+        *response = discover (message);
+        return false;
+    }
+    case QJsonChannelMessage::Request:
+    case QJsonChannelMessage::Notification: {
+        if (resolve (message.methodPath (), entry))
+            return true;
+
+        // unknown method: let the service report it, if the service exists
+        QByteArray                          serviceName = message.serviceName ().toLatin1 ();
+        QSharedPointer<QJsonChannelService> service     = findService (serviceName);
+        if (!service) {
+            if (message.type () == QJsonChannelMessage::Request) {
+                QJsonChannelDebug () << Q_FUNC_INFO << "service" << serviceName << "not found";
+                *response = message.createStandardErrorResponse (QJsonChannel::MethodNotFound);
+                return false;
+            }
+        } else {
+            *response = service->dispatch (message);
+            return false;
+        }
+    } break;
+
+    case QJsonChannelMessage::Response:
+        // we don't handle responses in the provider
+        break;
+
+    default: {
+        *response = message.createStandardErrorResponse (QJsonChannel::InvalidRequest);
+        return false;
+    }
+    };
+
+    *response = QJsonChannelMessage ();
+    return false;
+}
+
+// Counts the call and measures the dispatch till the completion, if the metrics are enabled
+static QJsonChannelCompletion measured (const QJsonChannelMessage& message, const QJsonChannelCompletion& completion) {
+    if (!QJsonChannelMetrics::isEnabled ())
+        return completion;
+
+    QSharedPointer<QJsonChannelMetrics::StageTimer> timer (new QJsonChannelMetrics::StageTimer (QJsonChannelMetrics::Dispatch));
+    const QByteArray                                methodPath = message.methodPath ();
+    return [timer, methodPath, completion] (const QJsonChannelMessage& response) {
+        timer->stop ();
+        QJsonChannelMetrics::recordCall (methodPath, response);
+        completion (response);
+    };
+}
+
+// Serializes a response compactly, nothing is replied for an invalid response
+static QByteArray compactJson (const QJsonChannelMessage& response) {
+    if (!response.isValid ())
+        return QByteArray ();
+
+    QJsonChannelMetrics::StageTimer timer (QJsonChannelMetrics::Serialize);
+    return response.toJson (QJsonDocument::Compact);
+}
+
+QThreadPool* QJsonChannelServiceRepositoryPrivate::threadPool () const {
+    QThreadPool* pool = _threadPool.loadAcquire ();
+    return pool ? pool : QThreadPool::globalInstance ();
+}
+
+class QJsonChannelFunctionRunnable : public QRunnable {
+public:
+    explicit QJsonChannelFunctionRunnable (const std::function<void ()>& function) : _function (function) {
+    }
+
+    void run () override {
+        _function ();
+    }
+
+private:
+    std::function<void ()> _function;
+};
+
+// Shared state of a batch: the calling thread and the pool helpers pull requests from the same queue,
+// so the batch is completed even if no pool thread is available.
+struct QJsonChannelBatch {
+    const QJsonChannelServiceRepository* _repository = nullptr;
+    QVector<QJsonChannelMessage>         _requests;
+    QVector<QJsonChannelMessage>         _responses;
+    QVector<int>                         _parallel;
+    QAtomicInt                           _next;
+    QSemaphore                           _done;
+
+    bool processNext () {
+        int i = _next.fetchAndAddOrdered (1);
+        if (i >= _parallel.size ())
+            return false;
+
+        int index                = _parallel.at (i);
+        _responses.data ()[index] = _repository->processMessage (_requests.at (index));
+        _done.release ();
+        return true;
+    }
+};
+
+class QJsonChannelBatchRunnable : public QRunnable {
+public:
+    QJsonChannelBatchRunnable (const QSharedPointer<QJsonChannelBatch>& batch) : _batch (batch) {
+    }
+
+    void run () override {
+        while (_batch->processNext ())
+            ;
+    }
+
+private:
+    QSharedPointer<QJsonChannelBatch> _batch;
+};
+
+// The plain discovery result is the services map. A client passing {"tag": ...} gets the tagged document,
+// or a "not modified" reply if its tag is current.
+QJsonChannelMessage QJsonChannelServiceRepositoryPrivate::discover (const QJsonChannelMessage& message) const {
+    const QJsonValue params = message.params ();
+    ReadGuard        snapshot (this);
+    if (!params.isObject () || !params.toObject ().contains (QLatin1String ("tag")))
+        return message.createSerializedResponse (snapshot->_discovery);
+
+    if (params.toObject ().value (QLatin1String ("tag")).toString ().toLatin1 () == snapshot->_discoveryTag)
+        return message.createSerializedResponse (snapshot->_notModified);
+    return message.createSerializedResponse (snapshot->_taggedDiscovery);
 }
 
 QJsonChannelServiceRepository::QJsonChannelServiceRepository () : d (new QJsonChannelServiceRepositoryPrivate) {
@@ -48,12 +357,21 @@ bool QJsonChannelServiceRepository::addService (const QSharedPointer<QJsonChanne
         return false;
     }
 
-    if (d->_services.contains (serviceName)) {
+    QMutexLocker                 lock (&d->_writeMutex);
+    const QJsonChannelServiceHash& services = d->_snapshot.loadAcquire ()->_services;
+    if (services.contains (serviceName)) {
         QJsonChannelDebug () << Q_FUNC_INFO << "service with name " << serviceName << " already exist";
         return false;
     }
 
-    d->_services.insert (serviceName, service);
+    QJsonChannelServiceSnapshot* snapshot = new QJsonChannelServiceSnapshot;
+    snapshot->_services                   = services;
+    snapshot->_dispatchTable              = d->_snapshot.loadAcquire ()->_dispatchTable;
+    snapshot->_discoveryMembers           = d->_snapshot.loadAcquire ()->_discoveryMembers;
+    snapshot->_services.insert (serviceName, service);
+    snapshot->insertMethods (serviceName, service);
+    snapshot->insertDiscovery (serviceName, service);
+    d->publish (snapshot);
     return true;
 }
 
@@ -63,65 +381,272 @@ bool QJsonChannelServiceRepository::addService (const QSharedPointer<QJsonChanne
 //}
 
 bool QJsonChannelServiceRepository::removeService (const QByteArray& serviceName) {
-    if (!d->_services.contains (serviceName)) {
+    QMutexLocker                 lock (&d->_writeMutex);
+    const QJsonChannelServiceHash& services = d->_snapshot.loadAcquire ()->_services;
+    if (!services.contains (serviceName)) {
         QJsonChannelDebug () << Q_FUNC_INFO << "can not find service with name " << serviceName;
         return false;
     }
 
-    d->_services.remove (serviceName);
+    QJsonChannelServiceSnapshot* snapshot = new QJsonChannelServiceSnapshot;
+    snapshot->_services                   = services;
+    snapshot->_dispatchTable              = d->_snapshot.loadAcquire ()->_dispatchTable;
+    snapshot->_discoveryMembers           = d->_snapshot.loadAcquire ()->_discoveryMembers;
+    snapshot->removeMethods (services.value (serviceName));
+    snapshot->removeDiscovery (serviceName);
+    snapshot->_services.remove (serviceName);
+    d->publish (snapshot);
     return true;
 }
 
-QSharedPointer<QJsonChannelService> QJsonChannelServiceRepository::getService (const QByteArray& serviceName) {
-    if (!d->_services.contains (serviceName)) {
-        return nullptr;
-    }
+QByteArray QJsonChannelServiceRepository::discoveryTag () const {
+    QJsonChannelServiceRepositoryPrivate::ReadGuard snapshot (d.data ());
+    return snapshot->_discoveryTag;
+}
 
-    return d->_services.value (serviceName);
+QSharedPointer<QJsonChannelService> QJsonChannelServiceRepository::getService (const QByteArray& serviceName) const {
+    return d->findService (serviceName);
 }
 
 QSharedPointer<QObject> QJsonChannelServiceRepository::getServiceObject (const QByteArray& serviceName) {
-    if (!d->_services.contains (serviceName)) {
+    QSharedPointer<QJsonChannelService> service = d->findService (serviceName);
+    if (!service) {
         return nullptr;
     }
 
-    return d->_services.value (serviceName)->serviceObj ();
+    return service->serviceObj ();
 }
 
 QJsonChannelMessage QJsonChannelServiceRepository::processMessage (const QJsonChannelMessage& message) const {
-    switch (message.type ()) {
-    case QJsonChannelMessage::Discrovery: {
-        QJsonChannelMessage response = message.createResponse (d->servicesInfo ());
+    QJsonChannelMetrics::StageTimer timer (QJsonChannelMetrics::Dispatch);
+    QJsonChannelDispatchEntry       entry;
+    QJsonChannelMessage             response;
+    if (!d->route (message, &entry, &response)) {
+        QJsonChannelMetrics::recordCall (QByteArray (), response);
         return response;
     }
-    case QJsonChannelMessage::Request:
-    case QJsonChannelMessage::Notification: {
-        //
-        QByteArray serviceName = message.serviceName ().toLatin1 ();
-        if (serviceName.isEmpty () || !d->_services.contains (serviceName)) {
-            if (message.type () == QJsonChannelMessage::Request) {
-                QJsonChannelMessage error =
-                    message.createErrorResponse (QJsonChannel::MethodNotFound, QString ("service '%1' not found").arg (serviceName.constData ()));
-                return error;
+
+    response = entry._service->dispatch (message, entry._method);
+    QJsonChannelMetrics::recordCall (message.methodPath (), response);
+    return response;
+}
+
+void QJsonChannelServiceRepository::processMessageAsync (const QJsonChannelMessage& message, const QJsonChannelCompletion& completion) const {
+    const QJsonChannelServiceRepositoryPrivate* repository = d.data ();
+    repository->threadPool ()->start (new QJsonChannelFunctionRunnable ([repository, message, completion] () {
+        QJsonChannelDispatchEntry entry;
+        QJsonChannelMessage       response;
+        if (!repository->route (message, &entry, &response)) {
+            QJsonChannelMetrics::recordCall (QByteArray (), response);
+            completion (response);
+            return;
+        }
+
+        entry._service->dispatch (message, entry._method, measured (message, completion));
+    }));
+}
+
+bool QJsonChannelServiceRepository::postNotification (const QJsonChannelMessage& message) const {
+    if (message.type () != QJsonChannelMessage::Notification)
+        return false;
+
+    const QJsonChannelServiceRepositoryPrivate* repository = d.data ();
+    int                                         queued     = repository->_notificationsQueued.fetchAndAddOrdered (1) + 1;
+    if (queued > repository->_notificationLimit.loadAcquire ()) {
+        // backpressure: the queue is full, the notification is dropped
+        repository->_notificationsQueued.deref ();
+        repository->_notificationsRejected.fetchAndAddRelaxed (1);
+        return false;
+    }
+
+    int peak = repository->_notificationsPeak.loadAcquire ();
+    while (queued > peak && !repository->_notificationsPeak.testAndSetOrdered (peak, queued))
+        peak = repository->_notificationsPeak.loadAcquire ();
+    repository->_notificationsPosted.fetchAndAddRelaxed (1);
+
+    repository->threadPool ()->start (new QJsonChannelFunctionRunnable ([repository, message] () {
+        auto done = [repository] (const QJsonChannelMessage&) {
+            repository->_notificationsProcessed.fetchAndAddRelaxed (1);
+            repository->_notificationsQueued.deref ();
+        };
+
+        QJsonChannelDispatchEntry entry;
+        QJsonChannelMessage       response;
+        if (!repository->route (message, &entry, &response)) {
+            done (response);
+            return;
+        }
+
+        entry._service->dispatch (message, entry._method, measured (message, done));
+    }));
+    return true;
+}
+
+void QJsonChannelServiceRepository::setNotificationQueueLimit (int limit) {
+    d->_notificationLimit.storeRelease (qMax (1, limit));
+}
+
+QJsonChannelNotificationStats QJsonChannelServiceRepository::notificationStats () const {
+    QJsonChannelNotificationStats stats;
+    stats.posted     = d->_notificationsPosted.loadAcquire ();
+    stats.processed  = d->_notificationsProcessed.loadAcquire ();
+    stats.rejected   = d->_notificationsRejected.loadAcquire ();
+    stats.queued     = d->_notificationsQueued.loadAcquire ();
+    stats.peakQueued = d->_notificationsPeak.loadAcquire ();
+    return stats;
+}
+
+QFuture<QJsonChannelMessage> QJsonChannelServiceRepository::processMessageAsync (const QJsonChannelMessage& message) const {
+    QFutureInterface<QJsonChannelMessage> promise;
+    promise.reportStarted ();
+    QFuture<QJsonChannelMessage> future = promise.future ();
+
+    processMessageAsync (message, [promise] (const QJsonChannelMessage& response) mutable {
+        promise.reportResult (response);
+        promise.reportFinished ();
+    });
+    return future;
+}
+
+void QJsonChannelServiceRepository::setThreadPool (QThreadPool* pool) {
+    d->_threadPool.storeRelease (pool);
+}
+
+QThreadPool* QJsonChannelServiceRepository::threadPool () const {
+    return d->threadPool ();
+}
+
+QList<QJsonChannelMessage> QJsonChannelServiceRepository::processBatch (const QList<QJsonChannelMessage>& messages) const {
+    QSharedPointer<QJsonChannelBatch> batch (new QJsonChannelBatch);
+    batch->_repository = this;
+    batch->_requests   = messages.toVector ();
+    batch->_responses.resize (messages.size ());
+
+    QVector<int> sequential;
+    for (int i = 0; i < messages.size (); ++i) {
+        const QJsonChannelMessage& message = messages.at (i);
+        if (message.type () == QJsonChannelMessage::Request || message.type () == QJsonChannelMessage::Notification) {
+            QJsonChannelDispatchEntry entry;
+            if (d->resolve (message.methodPath (), &entry) && entry._service->isThreadSafe ()) {
+                batch->_parallel.append (i);
+                continue;
             }
-        } else {
-            QSharedPointer<QJsonChannelService> service  = d->_services.value (serviceName);
-            QJsonChannelMessage                 response = service->dispatch (message);
-            return response;
         }
-    } break;
+        sequential.append (i);
+    }
 
-    case QJsonChannelMessage::Response:
-        // we don't handle responses in the provider
-        return QJsonChannelMessage ();
-        break;
+    // the calling thread takes part in the processing, so one request less goes to the pool
+    QThreadPool* pool    = d->threadPool ();
+    int          helpers = qMin (batch->_parallel.size () - 1, pool->maxThreadCount ());
+    for (int i = 0; i < helpers; ++i)
+        pool->start (new QJsonChannelBatchRunnable (batch));
 
-    default: {
-        QJsonChannelMessage error = message.createErrorResponse (QJsonChannel::InvalidRequest, QString ("invalid request"));
-        return error;
-        break;
+    for (int index : sequential)
+        batch->_responses[index] = processMessage (batch->_requests.at (index));
+
+    while (batch->processNext ())
+        ;
+    batch->_done.acquire (batch->_parallel.size ());
+
+    // notifications are never answered, not even with an error
+    QList<QJsonChannelMessage> responses;
+    responses.reserve (messages.size ());
+    for (int i = 0; i < messages.size (); ++i) {
+        const QJsonChannelMessage& response = batch->_responses.at (i);
+        if (messages.at (i).type () != QJsonChannelMessage::Notification && response.isValid ())
+            responses.append (response);
     }
-    };
+    return responses;
+}
+
+QByteArray QJsonChannelServiceRepository::processJson (const QByteArray& data) const {
+    // a single message goes through the envelope parser, batches and malformed data through the JSON document
+    QJsonChannelMetrics::StageTimer parse (QJsonChannelMetrics::Parse);
+    QJsonChannelMessage             message = QJsonChannelMessage::fromJson (data);
+    if (message.isValid ()) {
+        parse.stop ();
+        return compactJson (processMessage (message));
+    }
+
+    QJsonParseError error;
+    QJsonDocument   document = QJsonDocument::fromJson (data, &error);
+    if (error.error != QJsonParseError::NoError) {
+        parse.stop ();
+        QJsonChannelDebug () << Q_FUNC_INFO << error.errorString ();
+        QJsonChannelMessage response = QJsonChannelMessage ().createStandardErrorResponse (QJsonChannel::ParseError);
+        QJsonChannelMetrics::recordCall (QByteArray (), response);
+        return compactJson (response);
+    }
+
+    if (document.isObject ()) {
+        QJsonChannelMessage request = QJsonChannelMessage::fromObject (document.object ());
+        parse.stop ();
+        return compactJson (processMessage (request));
+    }
+
+    const QJsonArray array = document.array ();
+    if (array.isEmpty ()) {
+        parse.stop ();
+        QJsonChannelMessage response = QJsonChannelMessage ().createErrorResponse (QJsonChannel::InvalidRequest, "empty batch");
+        QJsonChannelMetrics::recordCall (QByteArray (), response);
+        return compactJson (response);
+    }
+
+    QList<QJsonChannelMessage> messages;
+    messages.reserve (array.size ());
+    for (const QJsonValue& value : array) {
+        // not an object gives an invalid message which is answered with InvalidRequest
+        messages.append (QJsonChannelMessage::fromObject (value.toObject ()));
+    }
+    parse.stop ();
+
+    const QList<QJsonChannelMessage>& responses = processBatch (messages);
+    if (responses.isEmpty ())
+        return QByteArray ();
+
+    QJsonChannelMetrics::StageTimer serialize (QJsonChannelMetrics::Serialize);
+    QByteArray                      result;
+    result += '[';
+    for (const QJsonChannelMessage& response : responses) {
+        if (result.size () > 1)
+            result += ',';
+        response.writeJson (result);
+    }
+    result += ']';
+    return result;
+}
+
+QByteArray QJsonChannelServiceRepository::processData (const QByteArray& data, const QJsonChannelCodec* codec) const {
+    if (!codec || codec == QJsonChannelCodec::json ())
+        return processJson (data);
+
+    QJsonChannelMetrics::StageTimer parse (QJsonChannelMetrics::Parse);
+    QList<QJsonChannelMessage>      messages;
+    bool                            batch   = false;
+    const bool                      decoded = codec->decode (data, &messages, &batch);
+    parse.stop ();
+
+    QList<QJsonChannelMessage> responses;
+    if (!decoded) {
+        QJsonChannelDebug () << Q_FUNC_INFO << "can't decode" << codec->name () << "data";
+        responses.append (QJsonChannelMessage ().createStandardErrorResponse (QJsonChannel::ParseError));
+        QJsonChannelMetrics::recordCall (QByteArray (), responses.first ());
+        batch = false;
+    } else if (!batch) {
+        QJsonChannelMessage response = processMessage (messages.first ());
+        if (response.isValid ())
+            responses.append (response);
+    } else if (messages.isEmpty ()) {
+        responses.append (QJsonChannelMessage ().createErrorResponse (QJsonChannel::InvalidRequest, "empty batch"));
+        QJsonChannelMetrics::recordCall (QByteArray (), responses.first ());
+        batch = false;
+    } else {
+        responses = processBatch (messages);
+    }
+
+    if (responses.isEmpty ())
+        return QByteArray ();
 
-    return QJsonChannelMessage ();
+    QJsonChannelMetrics::StageTimer serialize (QJsonChannelMetrics::Serialize);
+    return codec->encode (responses, batch);
 }
@@ -1,13 +1,28 @@
 #pragma once
 
 #include <QScopedPointer>
+#include <QList>
+#include <QFuture>
 
-#include "QJsonChannelGlobal.h"
+#include "QJsonChannelMessage.h"
 
-class QJsonChannelMessage;
+class QThreadPool;
+class QJsonChannelCodec;
 class QJsonChannelService;
 class QJsonChannelServiceRepositoryPrivate;
 
+/**
+ * @brief Counters of the fire-and-forget notification queue
+ * 
+ */
+struct QJsonChannelNotificationStats {
+    quint64 posted     = 0; //!< Notifications accepted to the queue
+    quint64 processed  = 0; //!< Notifications dispatched to the services
+    quint64 rejected   = 0; //!< Notifications dropped because the queue was full
+    int     queued     = 0; //!< Notifications accepted and not processed yet
+    int     peakQueued = 0; //!< The highest number of queued notifications
+};
+
 /**
  * @brief The main entity of QJsonChannel represents service repository and provides API for a JSON-RPC method invokation.
  * 
@@ -56,7 +71,7 @@ public:
      * @param serviceName a service name to search
      * @return QSharedPointer <QJsonChannelService>  a found sevice 
      */
-    QSharedPointer<QJsonChannelService> getService (const QByteArray& serviceName);
+    QSharedPointer<QJsonChannelService> getService (const QByteArray& serviceName) const;
 
     /**
      * @brief Return service object by name
@@ -75,6 +90,15 @@ public:
      */
     bool removeService (const QByteArray& serviceName);
 
+    /**
+     * @brief Returns the tag of the current discovery document, it's changed when services are added or removed.
+     * A discovery request with {"tag": tag} params gets {"notModified": true, "tag": tag} if the tag is current,
+     * otherwise {"services": discovery document, "tag": new tag}.
+     * 
+     * @return QByteArray Hex hash of the discovery document
+     */
+    QByteArray discoveryTag () const;
+
     /**
      * @brief Process a JSON-RPC message. In general it means the invocation of a requested function of a requested service
      * 
@@ -83,6 +107,87 @@ public:
      */
     QJsonChannelMessage processMessage (const QJsonChannelMessage& message) const;
 
+    /**
+     * @brief Process a JSON-RPC message on the repository thread pool. The repository should outlive the processing.
+     * Methods returning QFuture (see qJsonChannelRegisterFuture) don't occupy a pool thread while the future is running.
+     * 
+     * @param message JSON-RPC message
+     * @return QFuture<QJsonChannelMessage> JSON-RPC response message
+     */
+    QFuture<QJsonChannelMessage> processMessageAsync (const QJsonChannelMessage& message) const;
+
+    /**
+     * @brief Process a JSON-RPC message on the repository thread pool
+     * 
+     * @param message JSON-RPC message
+     * @param completion Receives JSON-RPC response message, it's called on a pool thread or on a future waiter thread for QFuture results
+     */
+    void processMessageAsync (const QJsonChannelMessage& message, const QJsonChannelCompletion& completion) const;
+
+    /**
+     * @brief Queues a JSON-RPC notification for fire-and-forget processing on the repository thread pool.
+     * The method result isn't converted and nothing is replied.
+     * 
+     * @param message JSON-RPC notification message
+     * @return true The notification is queued
+     * @return false The message is not a notification or the queue is full
+     */
+    bool postNotification (const QJsonChannelMessage& message) const;
+
+    /**
+     * @brief Sets the maximum number of queued notifications, postNotification rejects notifications beyond it
+     * 
+     * @param limit Queue limit, 1024 by default
+     */
+    void setNotificationQueueLimit (int limit);
+
+    /**
+     * @brief Returns the counters of the notification queue
+     * 
+     * @return QJsonChannelNotificationStats 
+     */
+    QJsonChannelNotificationStats notificationStats () const;
+
+    /**
+     * @brief Sets the thread pool for asynchronous and batch processing
+     * 
+     * @param pool Thread pool, QThreadPool::globalInstance () is used if it's nullptr
+     */
+    void setThreadPool (QThreadPool* pool);
+
+    /**
+     * @brief Returns the thread pool for asynchronous and batch processing
+     * 
+     * @return QThreadPool* 
+     */
+    QThreadPool* threadPool () const;
+
+    /**
+     * @brief Process a JSON-RPC batch. Requests to thread-safe services are dispatched in parallel, 
+     * other requests are processed one by one on the calling thread.
+     * 
+     * @param messages JSON-RPC messages of the batch
+     * @return QList<QJsonChannelMessage> JSON-RPC response messages in the order of the requests, notifications produce no response
+     */
+    QList<QJsonChannelMessage> processBatch (const QList<QJsonChannelMessage>& messages) const;
+
+    /**
+     * @brief Process a serialized JSON-RPC message or batch (JSON array of messages)
+     * 
+     * @param data String data
+     * @return QByteArray Serialized response or array of responses, empty if nothing should be replied
+     */
+    QByteArray processJson (const QByteArray& data) const;
+
+    /**
+     * @brief Process a JSON-RPC message or batch encoded by the codec negotiated for the channel (see QJsonChannelCodec::negotiate)
+     * 
+     * @param data Encoded data
+     * @param codec Codec of the channel, JSON if it's nullptr
+     * @return QByteArray Encoded response or array of responses, empty if nothing should be replied
+     */
+    QByteArray processData (const QByteArray& data, const QJsonChannelCodec* codec) const;
+
 private:
     QScopedPointer<QJsonChannelServiceRepositoryPrivate> d;
 };
@@ -0,0 +1,177 @@
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QWriteLocker>
+
+#include "QJsonChannelService.h"
+#include "QJsonChannelServiceRepository.h"
+#include "QJsonChannelSession.h"
+
+// A call of the session, serial is the name of its service if the service calls run one by one
+struct QJsonChannelSessionCall {
+    QJsonChannelMessage _message;
+    QByteArray          _serial;
+};
+
+class QJsonChannelSessionPrivate {
+public:
+    QByteArray serial (const QJsonChannelMessage& message) const;
+
+    // should be called with _mutex locked, the calls to start are collected to be started after unlocking
+    void schedule (const QJsonChannelSessionCall& call, QList<QJsonChannelSessionCall>* started);
+    void start (const QList<QJsonChannelSessionCall>& calls);
+    void finished (const QByteArray& serial, const QJsonChannelMessage& response);
+
+    const QJsonChannelServiceRepository*     _repository = nullptr;
+    QJsonChannelCompletion                   _responder;
+    int                                      _maxConcurrentCalls = 16;
+    int                                      _maxQueuedCalls     = 1024;
+    QWeakPointer<QJsonChannelSessionPrivate> _self;
+
+    // the responder is called under the read lock (recursively if it submits a call completed inline),
+    // the destroyed session closes it under the write lock
+    QReadWriteLock _responderLock {QReadWriteLock::Recursive};
+    bool           _closed = false;
+
+    mutable QMutex                                     _mutex;
+    int                                                _running = 0;
+    int                                                _queued  = 0;
+    QQueue<QJsonChannelSessionCall>                    _waiting;    // calls beyond the cap
+    QHash<QByteArray, QQueue<QJsonChannelSessionCall>> _serialized; // service name -> calls waiting for the busy service
+    QSet<QByteArray>                                   _busy;       // services which are not thread safe with a running call
+};
+
+QByteArray QJsonChannelSessionPrivate::serial (const QJsonChannelMessage& message) const {
+    if (message.type () != QJsonChannelMessage::Request && message.type () != QJsonChannelMessage::Notification)
+        return QByteArray ();
+
+    // thread safe services are called concurrently, executors queue the calls by themselves
+    const QByteArray                    serviceName = message.serviceName ().toLatin1 ();
+    QSharedPointer<QJsonChannelService> service     = _repository->getService (serviceName);
+    if (!service || service->isThreadSafe () || service->executorMode () != QJsonChannelService::NoExecutor)
+        return QByteArray ();
+    return serviceName;
+}
+
+void QJsonChannelSessionPrivate::schedule (const QJsonChannelSessionCall& call, QList<QJsonChannelSessionCall>* started) {
+    if (_running >= _maxConcurrentCalls) {
+        _waiting.enqueue (call);
+        ++_queued;
+        return;
+    }
+
+    if (!call._serial.isEmpty ()) {
+        if (_busy.contains (call._serial)) {
+            _serialized[call._serial].enqueue (call);
+            ++_queued;
+            return;
+        }
+        _busy.insert (call._serial);
+    }
+
+    ++_running;
+    started->append (call);
+}
+
+void QJsonChannelSessionPrivate::start (const QList<QJsonChannelSessionCall>& calls) {
+    // the completions keep the state alive, the session may be destroyed before them
+    QSharedPointer<QJsonChannelSessionPrivate> self = _self.toStrongRef ();
+    for (const QJsonChannelSessionCall& call : calls) {
+        const QByteArray serial = call._serial;
+        _repository->processMessageAsync (call._message, [self, serial] (const QJsonChannelMessage& response) { self->finished (serial, response); });
+    }
+}
+
+void QJsonChannelSessionPrivate::finished (const QByteArray& serial, const QJsonChannelMessage& response) {
+    // the response goes out before the next calls are started, a late response of a destroyed session is dropped
+    {
+        QReadLocker lock (&_responderLock);
+        if (!_closed && response.isValid ())
+            _responder (response);
+    }
+
+    QList<QJsonChannelSessionCall> started;
+    {
+        QMutexLocker lock (&_mutex);
+        --_running;
+
+        // the service stays busy while it has waiting calls
+        if (!serial.isEmpty ()) {
+            auto it = _serialized.find (serial);
+            if (it != _serialized.end ()) {
+                started.append (it.value ().dequeue ());
+                if (it.value ().isEmpty ())
+                    _serialized.erase (it);
+                --_queued;
+                ++_running;
+            } else {
+                _busy.remove (serial);
+            }
+        }
+
+        while (_running < _maxConcurrentCalls && !_waiting.isEmpty ()) {
+            --_queued;
+            schedule (_waiting.dequeue (), &started);
+        }
+    }
+    start (started);
+}
+
+QJsonChannelSession::QJsonChannelSession (const QJsonChannelServiceRepository* repository, const QJsonChannelCompletion& responder, int maxConcurrentCalls,
+                                          int maxQueuedCalls)
+    : d (new QJsonChannelSessionPrivate) {
+    d->_self               = d;
+    d->_repository         = repository;
+    d->_responder          = responder;
+    d->_maxConcurrentCalls = qMax (1, maxConcurrentCalls);
+    d->_maxQueuedCalls     = qMax (0, maxQueuedCalls);
+}
+
+QJsonChannelSession::~QJsonChannelSession () {
+    {
+        QWriteLocker lock (&d->_responderLock);
+        d->_closed = true;
+    }
+
+    // the completions of the running calls find no calls to start
+    QMutexLocker lock (&d->_mutex);
+    d->_waiting.clear ();
+    d->_serialized.clear ();
+    d->_queued = 0;
+}
+
+bool QJsonChannelSession::submit (const QJsonChannelMessage& message) {
+    QJsonChannelSessionCall call;
+    call._message = message;
+    call._serial  = d->serial (message);
+
+    QList<QJsonChannelSessionCall> started;
+    {
+        QMutexLocker lock (&d->_mutex);
+        const bool waits = d->_running >= d->_maxConcurrentCalls || (!call._serial.isEmpty () && d->_busy.contains (call._serial));
+        if (waits && d->_queued >= d->_maxQueuedCalls) {
+            lock.unlock ();
+            QJsonChannelDebug () << Q_FUNC_INFO << "session is full";
+            if (message.type () == QJsonChannelMessage::Request)
+                d->_responder (message.createErrorResponse (QJsonChannel::ServerErrorBase, "too many pending calls"));
+            return false;
+        }
+        d->schedule (call, &started);
+    }
+    d->start (started);
+    return true;
+}
+
+int QJsonChannelSession::running () const {
+    QMutexLocker lock (&d->_mutex);
+    return d->_running;
+}
+
+int QJsonChannelSession::queued () const {
+    QMutexLocker lock (&d->_mutex);
+    return d->_queued;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QSharedPointer>
+
+#include "QJsonChannelMessage.h"
+
+class QJsonChannelServiceRepository;
+class QJsonChannelSessionPrivate;
+
+/**
+ * @brief Multiplexes the messages of a connection: requests are dispatched concurrently on the repository thread pool
+ * and every response is emitted as soon as its call is completed, clients match the responses by id.
+ * The calls of a service object which is not thread safe run one by one, so they don't occupy the pool threads waiting for the service mutex.
+ * The number of running calls is capped, the calls beyond the cap wait in the session.
+ *
+ */
+class QJSONCHANNELCORE_EXPORT QJsonChannelSession {
+public:
+    /**
+     * @brief Construct a new QJsonChannelSession object
+     *
+     * @param repository Service repository, should outlive the session and its running calls
+     * @param responder Receives the responses, it's called on the pool threads (or on a future waiter thread for QFuture results).
+     * It isn't called anymore once the session is destroyed, so it shouldn't destroy the session itself
+     * @param maxConcurrentCalls Maximum number of running calls
+     * @param maxQueuedCalls Maximum number of calls waiting in the session, further requests are answered with an error
+     */
+    QJsonChannelSession (const QJsonChannelServiceRepository* repository, const QJsonChannelCompletion& responder, int maxConcurrentCalls = 16,
+                         int maxQueuedCalls = 1024);
+
+    /**
+     * @brief Destroys the session without waiting for the running calls, their responses are dropped.
+     * Only a response being delivered to the responder is waited for. The waiting calls are dropped.
+     *
+     */
+    ~QJsonChannelSession ();
+
+    /**
+     * @brief Accepts a message of the connection
+     *
+     * @param message JSON-RPC request or notification
+     * @return true The message is running or waiting
+     * @return false The session is full, a request was answered with QJsonChannel::ServerErrorBase
+     */
+    bool submit (const QJsonChannelMessage& message);
+
+    /**
+     * @brief Returns the number of running calls
+     *
+     * @return int
+     */
+    int running () const;
+
+    /**
+     * @brief Returns the number of calls waiting for the cap or for their service
+     *
+     * @return int
+     */
+    int queued () const;
+
+private:
+    Q_DISABLE_COPY (QJsonChannelSession)
+
+    // shared with the completions of the running calls, which may finish after the session is gone
+    QSharedPointer<QJsonChannelSessionPrivate> d;
+};
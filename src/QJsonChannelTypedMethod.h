@@ -0,0 +1,277 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QObject>
+#include <QString>
+
+#include <type_traits>
+#include <utility>
+
+#include "QJsonChannelGlobal.h"
+
+// Conversion between JSON values and native values of the supported types, jsType is the JSON type of the values
+// (QJsonValue::Undefined accepts any type)
+template <typename T>
+struct QJsonChannelJsonTraits;
+
+template <>
+struct QJsonChannelJsonTraits<int> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static int fromJson (const QJsonValue& value) {
+        return int(qRound64 (value.toDouble ()));
+    }
+    static QJsonValue toJson (int value) {
+        return QJsonValue (value);
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<uint> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static uint fromJson (const QJsonValue& value) {
+        return uint(qRound64 (value.toDouble ()));
+    }
+    static QJsonValue toJson (uint value) {
+        return QJsonValue (double(value));
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<qlonglong> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static qlonglong fromJson (const QJsonValue& value) {
+        return qRound64 (value.toDouble ());
+    }
+    static QJsonValue toJson (qlonglong value) {
+        return QJsonValue (qint64(value));
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<qulonglong> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static qulonglong fromJson (const QJsonValue& value) {
+        return qulonglong(qRound64 (value.toDouble ()));
+    }
+    static QJsonValue toJson (qulonglong value) {
+        return QJsonValue (double(value));
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<double> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static double fromJson (const QJsonValue& value) {
+        return value.toDouble ();
+    }
+    static QJsonValue toJson (double value) {
+        return QJsonValue (value);
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<float> {
+    enum { jsType = QJsonValue::Double };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isDouble ();
+    }
+    static float fromJson (const QJsonValue& value) {
+        return float(value.toDouble ());
+    }
+    static QJsonValue toJson (float value) {
+        return QJsonValue (double(value));
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<bool> {
+    enum { jsType = QJsonValue::Bool };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isBool ();
+    }
+    static bool fromJson (const QJsonValue& value) {
+        return value.toBool ();
+    }
+    static QJsonValue toJson (bool value) {
+        return QJsonValue (value);
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<QString> {
+    enum { jsType = QJsonValue::String };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isString ();
+    }
+    static QString fromJson (const QJsonValue& value) {
+        return value.toString ();
+    }
+    static QJsonValue toJson (const QString& value) {
+        return QJsonValue (value);
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<QJsonValue> {
+    enum { jsType = QJsonValue::Undefined };
+
+    static bool accepts (const QJsonValue&) {
+        return true;
+    }
+    static QJsonValue fromJson (const QJsonValue& value) {
+        return value;
+    }
+    static QJsonValue toJson (const QJsonValue& value) {
+        return value;
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<QJsonObject> {
+    enum { jsType = QJsonValue::Object };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isObject ();
+    }
+    static QJsonObject fromJson (const QJsonValue& value) {
+        return value.toObject ();
+    }
+    static QJsonValue toJson (const QJsonObject& value) {
+        return QJsonValue (value);
+    }
+};
+
+template <>
+struct QJsonChannelJsonTraits<QJsonArray> {
+    enum { jsType = QJsonValue::Array };
+
+    static bool accepts (const QJsonValue& value) {
+        return value.isArray ();
+    }
+    static QJsonArray fromJson (const QJsonValue& value) {
+        return value.toArray ();
+    }
+    static QJsonValue toJson (const QJsonArray& value) {
+        return QJsonValue (value);
+    }
+};
+
+/**
+ * @brief Compile-time generated invoker of a typed service method, see QJsonChannelService::registerMethod
+ *
+ */
+struct QJsonChannelTypedMethod {
+    //! Converts the arguments (arity of them), invokes the method and converts its result, returns false if an argument has a wrong JSON type
+    bool (*invoke) (QObject* object, const QJsonValue* arguments, QJsonValue* result) = nullptr;
+    //! Returns true if the object is an instance of the method class
+    bool (*accepts) (QObject* object) = nullptr;
+    //! JSON types of the parameters
+    const int* parameterTypes = nullptr;
+    int        arity          = 0;
+    int        returnType     = QJsonValue::Undefined;
+    //! The method is const, so it's invoked under the shared lock
+    bool readOnly = false;
+};
+
+#if defined(__cpp_nontype_template_parameter_auto)
+
+namespace QJsonChannelTyped {
+
+template <typename T>
+using Plain = typename std::remove_cv<typename std::remove_reference<T>::type>::type;
+
+template <auto Function, typename Class, typename Return, typename... Args>
+struct Invoker {
+    static_assert (std::is_base_of<QObject, Class>::value, "typed methods should be members of the service object class");
+    static_assert (!std::disjunction<std::conjunction<std::is_lvalue_reference<Args>, std::negation<std::is_const<std::remove_reference_t<Args>>>>...>::value,
+                   "typed methods can't have out parameters");
+
+    template <std::size_t... I>
+    static bool invoke (QObject* object, const QJsonValue* arguments, QJsonValue* result, std::index_sequence<I...>) {
+        if (!(QJsonChannelJsonTraits<Plain<Args>>::accepts (arguments[I]) && ...))
+            return false;
+
+        Class* self = static_cast<Class*> (object);
+        if constexpr (std::is_void<Return>::value) {
+            (self->*Function) (QJsonChannelJsonTraits<Plain<Args>>::fromJson (arguments[I])...);
+            *result = QJsonValue ();
+        } else {
+            *result = QJsonChannelJsonTraits<Plain<Return>>::toJson ((self->*Function) (QJsonChannelJsonTraits<Plain<Args>>::fromJson (arguments[I])...));
+        }
+        return true;
+    }
+
+    static bool invoke (QObject* object, const QJsonValue* arguments, QJsonValue* result) {
+        return invoke (object, arguments, result, std::index_sequence_for<Args...> ());
+    }
+
+    static bool accepts (QObject* object) {
+        return dynamic_cast<Class*> (object) != nullptr;
+    }
+
+    static QJsonChannelTypedMethod method () {
+        // the last element keeps the array non-empty for methods without parameters
+        static const int parameterTypes[] = {QJsonChannelJsonTraits<Plain<Args>>::jsType..., QJsonValue::Undefined};
+
+        QJsonChannelTypedMethod method;
+        method.invoke         = &Invoker::invoke;
+        method.accepts        = &Invoker::accepts;
+        method.parameterTypes = parameterTypes;
+        method.arity          = int(sizeof...(Args));
+        if constexpr (!std::is_void<Return>::value)
+            method.returnType = QJsonChannelJsonTraits<Plain<Return>>::jsType;
+        return method;
+    }
+};
+
+template <auto Function, typename Class, typename Return, typename... Args>
+QJsonChannelTypedMethod makeMethod (Return (Class::*) (Args...)) {
+    return Invoker<Function, Class, Return, Args...>::method ();
+}
+
+template <auto Function, typename Class, typename Return, typename... Args>
+QJsonChannelTypedMethod makeMethod (Return (Class::*) (Args...) const) {
+    QJsonChannelTypedMethod method = Invoker<Function, Class, Return, Args...>::method ();
+    method.readOnly                = true;
+    return method;
+}
+
+} // namespace QJsonChannelTyped
+
+/**
+ * @brief Generates the typed invoker of a member function of a service object class
+ *
+ * @tparam Function Pointer to the member function
+ * @return QJsonChannelTypedMethod
+ */
+template <auto Function>
+QJsonChannelTypedMethod qJsonChannelTypedMethod () {
+    return QJsonChannelTyped::makeMethod<Function> (Function);
+}
+
+#endif